@@ -42,6 +42,7 @@
 #define KEY_PRESS_DELAY_TICKS_SUBSEQUENT 3500
 
 #define TEXTBUFFER_SIZE 10240
+#define SLICE_SIZE 1024
 char text_buffer[TEXTBUFFER_SIZE + 1];
 int text_buffer_pointer = 0;
 
@@ -462,11 +463,15 @@ int main(int argc, char **argv) {
     } else {
         printf("Loading game file %s + gfx file %s\n", argv[1], gfx_file);
     }
+    // disk images bigger than this would not fit in memory whole
+    SetScanWindow(0x20000);
+    // the scan is slow here, so keep what it finds beside the game
+    SetScanCache(TRUE);
     if (!LoadGame(argv[1], gfx_file)) {
         printf("Error: Unable to open game\n");
         return 0;
     }
-    while (RunGame());
+    while (RunGameSlice(SLICE_SIZE, NULL));
     StopGame();
     FreeMemory();
     return 0;
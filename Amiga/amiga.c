@@ -42,6 +42,7 @@
 #include <libraries/asl.h>
 #include <workbench/startup.h>
 #include "level9.h"
+#include "l9context.h"
 
 #define QUALIFIER_SHIFT (IEQUALIFIER_LSHIFT|IEQUALIFIER_RSHIFT)
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
@@ -88,8 +89,6 @@ int DisplayHeight, PreviousHeight;
 int MoreCount;
 int Playing;
 
-extern FILE* scriptfile;
-
 void amiga_init (char *dir);
 void screen_ratio (struct Screen *screen);
 void reset_cursor (void);
@@ -142,7 +141,7 @@ void os_printchar (char c)
 	  Window->BorderTop + (DisplayHeight + 1) * RastPort->TxHeight - 1, 0);
     reset_cursor ();
 
-    if (scriptfile == NULL)
+    if (l9ctx->scriptfile == NULL)
     {
       if (++MoreCount >= DisplayHeight)
       {
@@ -34,6 +34,8 @@ int TextBufferPtr = 0;
 int Column = 0;
 #define SCREENWIDTH 76
 
+#define SLICESIZE 4096
+
 char TestScript[MAX_PATH];
 int PlayScript = 1;
 
@@ -187,12 +189,24 @@ FILE *os_open_script_file()
 
 int main(int argc, char **argv)
 {
+	char *loadstats = NULL;
+
+	/* adds the game's load statistics to a file of JSON lines */
+	if (argc == 5 && strcmp(argv[1],"--load-stats") == 0)
+	{
+		loadstats = argv[2];
+		SetLoadStats(TRUE);
+		argv += 2;
+		argc -= 2;
+	}
 	if (argc != 3)
 		return 0;
 	if (!LoadGame(argv[1],NULL))
 		return 0;
 	strncpy(TestScript,argv[2],MAX_PATH-1);
-	while (RunGame());
+	while (RunGameSlice(SLICESIZE,NULL));
+	if (loadstats)
+		LoadStatsWrite(loadstats);
 	StopGame();
 	FreeMemory();
 	return 0;
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "level9.h"
+#include "l9context.h"
 
 unsigned _stklen = 16384;
 
@@ -57,7 +58,6 @@ int MoreCount = 0;
 #define KEY_F12   390
 
 L9UINT32 filelength(FILE *f);
-extern FILE* scriptfile;
 
 int character(void);
 void into_buffer(char *buffer,char *newb,int *x,int *i);
@@ -446,7 +446,7 @@ int i;
 
 void more_prompt(void)
 {
-	if (scriptfile != NULL)
+	if (l9ctx->scriptfile != NULL)
 		return;
 
 	MoreCount++;
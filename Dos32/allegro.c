@@ -49,6 +49,7 @@
 
 /* Definitions from the interpreter. */
 #include "level9.h"
+#include "l9context.h"
 
 /* Data for the font. */
 #include "font.h"
@@ -461,8 +462,6 @@ void screen_scroll(int y)
   rectfill(display,0,y,SCREEN_W-1,SCREEN_H-1,0);
 }
 
-extern FILE* scriptfile;
-
 /* Move the current text position down to the start of
    the next line. */
 void screen_newline(void)
@@ -480,7 +479,7 @@ void screen_newline(void)
        the last pause? If so, put up a [MORE] prompt. */
     if (page_counter >= page_limit)
     {
-      if (scriptfile == NULL)
+      if (l9ctx->scriptfile == NULL)
       {
         const char* more = "[MORE]";
 
@@ -48,11 +48,12 @@
 #define MIN_WINDOW_HEIGHT 200
 
 /*
- * It's probably more efficient to run a couple of instruction every time the
- * application is idle. This defines how many.
+ * Number of instructions run by RunGameSlice() every time the application
+ * is idle. The slice ends early when the game asks for input or flushes its
+ * output, so this can be fairly large without hurting responsiveness.
  */
 
-#define MAX_INSTRUCTIONS 20
+#define MAX_INSTRUCTIONS 1000
 
 /*
  * We insert "dummy" spaces to make sure that the editable region is never
@@ -75,22 +75,15 @@ gboolean stop_main_loop ()
 static gboolean main_loop (gpointer user_data)
 {
     gboolean result;
-    int i;
 
     /*
-     * Run a couple of instructions. This seems to be a bit more efficient than
-     * having the idle handler run one instruction every call. Maybe.
+     * Run a slice of instructions. The slice returns early when the game
+     * waits for input, so the idle handler stays responsive.
      */
-    
-    for (i = 0; i < MAX_INSTRUCTIONS; i++)
-    {
-	result = RunGame ();
-	if (!result)
-	{
-	    mainIdleHandler = 0;
-	    break;
-	}
-    }
+
+    result = RunGameSlice (MAX_INSTRUCTIONS, NULL);
+    if (!result)
+	mainIdleHandler = 0;
 
     return result;
 }
@@ -0,0 +1,353 @@
+/***********************************************************************\
+*
+* Level 9 interpreter
+* Ahead-of-time A-code translator
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+*
+* Use: l9aot <gamefile> <output.c>
+*
+* Loads a game, finds its reachable A-code with the same code walker
+* that the loader uses to find the game (ValidateSequence) and writes
+* the A-code out as C. Linking the output with level9.c built with
+* AOTCODE defined runs that game as native code. Anything the
+* translation does not cover is left to the interpreter: opcodes that
+* print, read input or draw, jump table dispatch to code that was not
+* found, and everything once the game writes into its own code. The
+* interpreter goes back into the native code at the next translated
+* opcode it reaches.
+*
+\***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "level9.h"
+#include "l9context.h"
+
+/* the most entries tried in each jump table */
+#define JUMPTABLEMAX 256
+/* the longest opcode that is translated */
+#define MAXOPLEN 8
+
+L9BOOL ValidateSequence(L9BYTE* Base,L9BYTE* Image,L9UINT32 iPos,L9UINT32 acode,L9UINT32 *Size,L9UINT32 DataSize,L9UINT32 *Min,L9UINT32 *Max,L9BOOL Rts,L9BOOL *JumpKill, L9BOOL *DriverV4);
+
+static L9BYTE *Base,*Image;	/* Image is ValidateSequence()'s map of opcode starts */
+static L9BYTE *Done;	/* jump tables that have been followed, a byte each */
+static L9UINT32 Size,ACode;
+static L9UINT32 Low,High;
+static FILE *out;
+
+static void walk(L9UINT32 Pos)
+{
+	L9UINT32 Count=0,Min=Pos,Max=Pos;
+	L9BOOL JumpKill;
+	ValidateSequence(Base,Image,Pos,ACode,&Count,Size,&Min,&Max,FALSE,&JumpKill,NULL);
+}
+
+/* follows the entries of each jump table until one leads to invalid code */
+static void walkjumptables(void)
+{
+	L9UINT32 Pos,Table,Target,Count,Min,Max;
+	L9BOOL Found=TRUE,JumpKill;
+	int i;
+
+	while (Found)
+	{
+		Found=FALSE;
+		for (Pos=0;Pos+3<Size;Pos++)
+		{
+			if (!IMAGETEST(Image,Pos) || Done[Pos] || (Base[Pos]&0x9f)!=0x0e) continue;
+			Done[Pos]=1;
+			Table=ACode+L9WORD(Base+Pos+1);
+			for (i=0;i<JUMPTABLEMAX && Table+2*i+1<Size;i++)
+			{
+				Target=ACode+L9WORD(Base+Table+2*i);
+				if (Target>=Size) break;
+				if (IMAGETEST(Image,Target)) continue;
+				Count=0;
+				Min=Max=Target;
+				if (!ValidateSequence(Base,Image,Target,ACode,&Count,Size,&Min,&Max,TRUE,&JumpKill,NULL))
+					break;
+				Found=TRUE;
+			}
+		}
+	}
+}
+
+/* jumps to a translated opcode if there is one, otherwise leaves it
+   to the interpreter */
+static void branch(long Target)
+{
+	if (Target>=0 && Target<(long) Size && IMAGETEST(Image,Target))
+		fprintf(out,"goto L%05lX;",(unsigned long) Target);
+	else
+		fprintf(out,"LEAVE(%ld);",Target);
+}
+
+static long getaddr(int Code,L9UINT32 *Pos)
+{
+	long Target;
+	if (Code&0x20)
+	{
+		Target=(long) *Pos+(signed char) Base[*Pos];
+		(*Pos)++;
+	}
+	else
+	{
+		Target=ACode+L9WORD(Base+*Pos);
+		(*Pos)+=2;
+	}
+	return Target;
+}
+
+static L9UINT16 getcon(int Code,L9UINT32 *Pos)
+{
+	L9UINT16 Con;
+	if (Code&0x40) return Base[(*Pos)++];
+	Con=L9WORD(Base+*Pos);
+	(*Pos)+=2;
+	return Con;
+}
+
+/* writes the opcode at Pos, returning FALSE if it never falls through */
+static L9BOOL translate(L9UINT32 Pos,L9UINT32 *Next)
+{
+	static const char* Compare[4]={"==","!=","<",">"};
+	int Code=Base[Pos],List;
+	L9UINT32 Start=Pos++;
+	int a,b;
+	L9UINT16 Con;
+	long Target;
+
+	fprintf(out,"L%05lX:\tSTEP(0x%lX);\n\t",(unsigned long) Start,(unsigned long) Start);
+	*Next=Start;
+	if (Start+MAXOPLEN>Size) Code=-1;
+
+	if (Code>=0 && (Code&0x80) && (Code&0x1f)<=0xa)
+	{
+		List=(Code+1)&0x1f;
+		a=Base[Pos++];
+		b=Base[Pos++];
+		switch (Code&0xe0)
+		{
+			case 0x80:
+				fprintf(out,"a4=L9Pointers[%d]+%d; LISTWRITE(%d,vars[%d],0x%lX);\n",List,a,List,b,(unsigned long) Pos);
+				break;
+			case 0xa0:
+				fprintf(out,"a4=L9Pointers[%d]+vars[%d]; vars[%d]=LISTREAD(%d);\n",List,a,b,List);
+				break;
+			case 0xc0:
+				fprintf(out,"a4=L9Pointers[%d]+%d; vars[%d]=LISTREAD(%d);\n",List,a,b,List);
+				break;
+			case 0xe0:
+				fprintf(out,"a4=L9Pointers[%d]+vars[%d]; LISTWRITE(%d,vars[%d],0x%lX);\n",List,a,List,b,(unsigned long) Pos);
+				break;
+		}
+	}
+	else if (Code>=0 && !(Code&0x80)) switch (Code&0x1f)
+	{
+		case 0: /* goto */
+			Target=getaddr(Code,&Pos);
+			if (Target==(long) Pos-2)
+				fprintf(out,"Running=FALSE; LEAVE(0x%lX);\n",(unsigned long) Pos);
+			else
+			{
+				branch(Target);
+				fprintf(out,"\n");
+			}
+			*Next=Pos;
+			return FALSE;
+		case 1: /* intgosub */
+			Target=getaddr(Code,&Pos);
+			fprintf(out,"PUSH(0x%lX,0x%04X); ",(unsigned long) Pos,(unsigned) ((Pos-ACode)&0xffff));
+			branch(Target);
+			fprintf(out,"\n");
+			*Next=Pos;
+			return FALSE;
+		case 2: /* intreturn */
+			fprintf(out,"POP(0x%lX); goto dispatch;\n",(unsigned long) Pos);
+			*Next=Pos;
+			return FALSE;
+		case 8: /* varcon */
+			Con=getcon(Code,&Pos);
+			fprintf(out,"vars[%d]=%u;\n",Base[Pos++],Con);
+			break;
+		case 9: /* varvar */
+			fprintf(out,"vars[%d]=vars[%d];\n",Base[Pos+1],Base[Pos]);
+			Pos+=2;
+			break;
+		case 10: /* _add */
+			fprintf(out,"d0=vars[%d]; vars[%d]+=d0;\n",Base[Pos],Base[Pos+1]);
+			Pos+=2;
+			break;
+		case 11: /* _sub */
+			fprintf(out,"d0=vars[%d]; vars[%d]-=d0;\n",Base[Pos],Base[Pos+1]);
+			Pos+=2;
+			break;
+		case 14: /* jump */
+			fprintf(out,"a4=acodeptr+((%u+(vars[%d]<<1))&0xffff); codeptr=acodeptr+L9WORD(a4); goto dispatch;\n",
+				(unsigned) L9WORD(Base+Pos),Base[Pos+2]);
+			*Next=Pos+3;
+			return FALSE;
+		case 16: /* ifeqvt */
+		case 17: /* ifnevt */
+		case 18: /* ifltvt */
+		case 19: /* ifgtvt */
+			a=Base[Pos++];
+			b=Base[Pos++];
+			Target=getaddr(Code,&Pos);
+			fprintf(out,"if (vars[%d]%svars[%d]) ",a,Compare[Code&3],b);
+			branch(Target);
+			fprintf(out,"\n");
+			break;
+		case 24: /* ifeqct */
+		case 25: /* ifnect */
+		case 26: /* ifltct */
+		case 27: /* ifgtct */
+			a=Base[Pos++];
+			Con=getcon(Code,&Pos);
+			Target=getaddr(Code,&Pos);
+			fprintf(out,"if (vars[%d]%s%u) ",a,Compare[Code&3],Con);
+			branch(Target);
+			fprintf(out,"\n");
+			break;
+		default:
+			Code=-1;
+			break;
+	}
+	else
+		Code=-1;
+
+	if (Code<0)
+	{
+		/* printing, input, graphics and the like stay with the interpreter */
+		fprintf(out,"LEGACY(0x%lX); goto dispatch;\n",(unsigned long) Start);
+		return FALSE;
+	}
+
+	if (Start<Low) Low=Start;
+	if (Pos>High) High=Pos;
+	*Next=Pos;
+	return TRUE;
+}
+
+int main(int argc, char **argv)
+{
+	L9UINT32 Pos,Next,Following;
+	L9BOOL Through;
+	int Entries,Bit;
+
+	if (argc!=3)
+	{
+		fprintf(stderr,"Use: %s <gamefile> <output.c>\n",argv[0]);
+		return 1;
+	}
+	if (!LoadGame(argv[1],NULL))
+	{
+		fprintf(stderr,"Error: Unable to load game file %s\n",argv[1]);
+		return 1;
+	}
+
+	Base=l9ctx->startdata;
+	Size=l9ctx->FileSize;
+	ACode=l9ctx->acodeptr-l9ctx->startdata;
+	Image=calloc(IMAGESIZE(Size+1),1);
+	Done=calloc(Size+1,1);
+	if (Image==NULL || Done==NULL)
+	{
+		fprintf(stderr,"Error: Out of memory\n");
+		return 1;
+	}
+	walk(ACode);
+	walkjumptables();
+
+	out=fopen(argv[2],"w");
+	if (out==NULL)
+	{
+		fprintf(stderr,"Error: Unable to create %s\n",argv[2]);
+		return 1;
+	}
+
+	fprintf(out,"/* A-code of %s, translated by l9aot */\n\n",argv[1]);
+	fprintf(out,"#include <stdio.h>\n#include \"level9.h\"\n");
+	fprintf(out,"#define L9CONTEXT_NAMES\n#include \"l9context.h\"\n\n");
+	fprintf(out,"void executeinstruction(void);\n");
+	fprintf(out,"void error(char *fmt,...);\n\n");
+	fprintf(out,"#define LEAVE(p) { codeptr=startdata+(p); return; }\n");
+	fprintf(out,"#define STEP(p) if (*n==0) LEAVE(p); (*n)--\n");
+	fprintf(out,"#define LISTREAD(i) ((a4>=L9ListMin[i] && a4<L9ListMax[i]) ? *a4 : 0)\n");
+	fprintf(out,"#define LISTWRITE(i,v,p) if (a4>=L9ListMin[i] && a4<L9ListMax[i]) \\\n"
+		"\t{ *a4=(L9BYTE) (v); MARKDIRTY(a4); if (a4>=aotlow && a4<aothigh) { aotvalid=FALSE; LEAVE(p); } }\n");
+	fprintf(out,"#define PUSH(p,r) if (workspace.stackptr==STACKSIZE) \\\n"
+		"\t{ error(\"\\rStack overflow error\\r\"); Running=FALSE; LEAVE(p); } \\\n"
+		"\tworkspace.stack[workspace.stackptr++]=(r)\n");
+	fprintf(out,"#define POP(p) if (workspace.stackptr==0) \\\n"
+		"\t{ error(\"\\rStack underflow error\\r\"); Running=FALSE; LEAVE(p); } \\\n"
+		"\tcodeptr=acodeptr+workspace.stack[--workspace.stackptr]\n");
+	fprintf(out,"#define LEGACY(p) codeptr=startdata+(p); code=*codeptr++; executeinstruction(); \\\n"
+		"\tif (!Running || RunReason!=L9_RUN_BUDGET || !aotvalid) return\n\n");
+
+	fprintf(out,"void l9aot_run(L9UINT32* n)\n{\n");
+	fprintf(out,"\tL9UINT16* vars=workspace.vartable;\n\tL9BYTE* a4;\n\tL9UINT16 d0;\n\n");
+	fprintf(out,"\tgoto dispatch;\n\n");
+
+	Low=Size;
+	High=0;
+	for (Pos=0;Pos<Size;Pos++)
+	{
+		if (!IMAGETEST(Image,Pos)) continue;
+		Through=translate(Pos,&Next);
+		if (Through)
+		{
+			for (Following=Pos+1;Following<Size && !IMAGETEST(Image,Following);Following++);
+			if (Following!=Next)
+			{
+				fprintf(out,"\t");
+				branch(Next);
+				fprintf(out,"\n");
+			}
+		}
+	}
+
+	fprintf(out,"\ndispatch:\n\tswitch (codeptr-startdata)\n\t{\n");
+	for (Pos=0;Pos<Size;Pos++)
+		if (IMAGETEST(Image,Pos)) fprintf(out,"\t\tcase 0x%lX: goto L%05lX;\n",(unsigned long) Pos,(unsigned long) Pos);
+	fprintf(out,"\t}\n}\n\n");
+
+	if (Low>High) Low=High=0;
+	fprintf(out,"const L9UINT32 l9aot_filesize=%lu,l9aot_acode=%lu,l9aot_low=%lu,l9aot_high=%lu;\n",
+		(unsigned long) Size,(unsigned long) ACode,(unsigned long) Low,(unsigned long) High);
+	fprintf(out,"const L9BYTE l9aot_code[]=\n{");
+	for (Pos=Low;Pos<High;Pos++)
+		fprintf(out,"%s%d",(Pos-Low)%24 ? "," : (Pos==Low ? "\n\t" : ",\n\t"),Base[Pos]);
+	fprintf(out,"%s\n};\n",Low==High ? "\t0" : "");
+	/* the opcodes there that the interpreter can go back into native code at */
+	fprintf(out,"const L9BYTE l9aot_entries[]=\n{");
+	for (Pos=0;Pos<IMAGESIZE(High-Low);Pos++)
+	{
+		for (Entries=0,Bit=0;Bit<8 && Low+Pos*8+Bit<High;Bit++)
+			if (IMAGETEST(Image,Low+Pos*8+Bit)) Entries|=1<<Bit;
+		fprintf(out,"%s%d",Pos%24 ? "," : (Pos==0 ? "\n\t" : ",\n\t"),Entries);
+	}
+	fprintf(out,"%s\n};\n",Low==High ? "\t0" : "");
+	fclose(out);
+
+	free(Image);
+	free(Done);
+	StopGame();
+	FreeMemory();
+	return 0;
+}
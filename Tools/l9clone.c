@@ -0,0 +1,140 @@
+/***********************************************************************\
+*
+* Level 9 interpreter
+* Session cloning benchmark
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+*
+* Use: l9clone <gamefile> [count]
+*
+* Compares the two ways of starting a new game session: loading the
+* game and running it up to its first input, and cloning a session
+* that has already got that far with CloneContext(). Prints the time
+* each takes and the memory each clone adds, with count clones (1000
+* by default) alive at once. The game's own text goes to stderr.
+*
+\***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "level9.h"
+#include "l9context.h"
+
+#define SLICESIZE 4096
+#define LOADS 20
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+static long maxrss(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF,&ru);
+	return ru.ru_maxrss;
+}
+
+/* loads the game into a new context and runs it until it asks for input */
+static L9Context* boot(char* filename)
+{
+	L9Context *ctx=NewContext();
+	L9RunReason reason;
+
+	SetContext(ctx);
+	SetResumableInput(TRUE);
+	if (!LoadGame(filename,NULL))
+	{
+		FreeContext(ctx);
+		return NULL;
+	}
+	while (RunGameSlice(SLICESIZE,&reason) && reason!=L9_NEED_INPUT)
+	{
+		if (reason==L9_NEED_KEY) L9SupplyInput("");
+	}
+	SetContext(NULL);
+	return ctx;
+}
+
+int main(int argc, char **argv)
+{
+	L9Context *template,**clones,*loaded[LOADS];
+	int count=argc>2 ? atoi(argv[2]) : 1000;
+	double start,loadtime,clonetime,freetime;
+	long rss;
+	int i;
+
+	if (argc<2 || argc>3 || count<1)
+	{
+		fprintf(stderr,"Use: %s <gamefile> [count]\n",argv[0]);
+		return 1;
+	}
+
+	/* kept until the end, so both ways have to fault in new memory */
+	start=now();
+	for (i=0;i<LOADS;i++)
+	{
+		if ((loaded[i]=boot(argv[1]))==NULL)
+		{
+			fprintf(stderr,"Unable to load %s\n",argv[1]);
+			return 1;
+		}
+	}
+	loadtime=(now()-start)/LOADS;
+
+	template=boot(argv[1]);
+	clones=malloc(count*sizeof(L9Context*));
+	rss=maxrss();
+	start=now();
+	for (i=0;i<count;i++)
+	{
+		if ((clones[i]=CloneContext(template))==NULL)
+		{
+			fprintf(stderr,"Out of memory after %d clones\n",i);
+			return 1;
+		}
+	}
+	clonetime=(now()-start)/count;
+	rss=maxrss()-rss;
+
+	/* check that a clone carries on from where the template was */
+	SetContext(clones[count-1]);
+	if (!L9SupplyInput("#quit"))
+		fprintf(stderr,"Clone is not waiting for input\n");
+	while (RunGameSlice(SLICESIZE,NULL));
+	SetContext(NULL);
+
+	start=now();
+	for (i=0;i<count;i++) FreeContext(clones[i]);
+	freetime=(now()-start)/count;
+
+	printf("load and run to first input: %10.1f us\n",loadtime*1e6);
+	printf("clone:                       %10.1f us (%.0f per second)\n",
+		clonetime*1e6,1/clonetime);
+	printf("free clone:                  %10.1f us\n",freetime*1e6);
+	printf("memory per clone:            %10.1f KB (context %u bytes, game data %lu bytes)\n",
+		(double) rss/count,(unsigned) sizeof(L9Context),
+		(unsigned long) (template->FileSize+(template->startdata-template->startfile)));
+	FreeContext(template);
+	for (i=0;i<LOADS;i++) FreeContext(loaded[i]);
+	free(clones);
+	return 0;
+}
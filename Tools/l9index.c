@@ -0,0 +1,319 @@
+/***********************************************************************\
+*
+* Level 9 interpreter
+* Game library indexer
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+*
+* Use: l9index [-a] [-c] [-f json|csv] [-j threads] <path> ...
+*
+* Loads every file under the given directories (and any files given)
+* as LoadGame() does, on several threads at once, and prints what was
+* found in each as JSON or CSV: the game type, the offset of its header
+* in the file, the message type of V1 and V2 games, the CRC-32 of the
+* file, the size of any picture data in it, the kind of bitmaps beside
+* it, and its name if it is a known game. Files with no game in them
+* are listed only with -a. With -c each game's scan cache is written,
+* so that interpreters start it without scanning the file again.
+*
+* The interface routines are those of l9stubs.c, except that messages
+* are dropped, as the threads would mix them up, and os_find_file()
+* looks for the file, for DetectBitmaps().
+*
+\***********************************************************************/
+
+/* for nftw() */
+#define _XOPEN_SOURCE 500
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "level9.h"
+#include "l9context.h"
+
+typedef struct
+{
+	char *path;
+	L9UINT32 size,crc;
+	int type;			/* -1 if no game was found */
+	long offset;
+	int msgtype;
+	L9UINT32 pictures;
+	BitmapType bitmaps;
+	const char *name;
+} Entry;
+
+static Entry *entries=NULL;
+static int count=0,allocated=0,next=0;
+static pthread_mutex_t mutex=PTHREAD_MUTEX_INITIALIZER;
+static L9BOOL writecache=FALSE;
+static L9UINT32 crctable[256];
+
+static char *types[]={"V1","V2","V3","V4"};
+static char *bitmaps[]={"","Amiga","PC1","PC2","C64","BBC","CPC","Mac","ST1","ST2"};
+
+void os_printchar(char c) { }
+L9BOOL os_input(char* ibuff, int size) { return FALSE; }
+char os_readchar(int millis) { return 0; }
+L9BOOL os_stoplist(void) { return FALSE; }
+void os_flush(void) { }
+L9BOOL os_save_file(L9BYTE* Ptr, int Bytes) { return FALSE; }
+L9BOOL os_load_file(L9BYTE* Ptr, int* Bytes, int Max) { return FALSE; }
+L9BOOL os_get_game_file(char* NewName, int Size) { return FALSE; }
+void os_set_filenumber(char* NewName, int Size, int n) { }
+void os_graphics(int mode) { }
+void os_cleargraphics(void) { }
+void os_setcolour(int colour, int index) { }
+void os_drawline(int x1, int y1, int x2, int y2, int colour1, int colour2) { }
+void os_fill(int x, int y, int colour1, int colour2) { }
+void os_show_bitmap(int pic, int x, int y) { }
+FILE* os_open_script_file(void) { return NULL; }
+L9BOOL os_find_file(char* NewName) { return access(NewName,R_OK)==0; }
+
+static void makecrctable(void)
+{
+	L9UINT32 c;
+	int i,j;
+
+	for (i=0;i<256;i++)
+	{
+		c=i;
+		for (j=0;j<8;j++) c=c&1 ? 0xedb88320UL^(c>>1) : c>>1;
+		crctable[i]=c;
+	}
+}
+
+/* the CRC-32 of the file, as zip uses, counting its size as it goes */
+static L9UINT32 filecrc(char* path,L9UINT32* length)
+{
+	L9BYTE buf[0x10000];
+	L9UINT32 crc=0xffffffffUL;
+	FILE *f=fopen(path,"rb");
+	size_t n,i;
+
+	*length=0;
+	if (f==NULL) return 0;
+	while ((n=fread(buf,1,sizeof buf,f))>0)
+	{
+		for (i=0;i<n;i++) crc=crctable[(crc^buf[i])&0xff]^(crc>>8);
+		*length+=n;
+	}
+	fclose(f);
+	return (crc^0xffffffffUL)&0xffffffffUL;
+}
+
+static int addfile(const char* path,const struct stat* st,int flag,struct FTW* ftw)
+{
+	size_t len=strlen(path);
+
+	/* the scan caches are not games */
+	if (flag!=FTW_F || (len>4 && strcmp(path+len-4,".l9c")==0)) return 0;
+	if (count==allocated)
+	{
+		allocated=allocated ? allocated*2 : 256;
+		entries=realloc(entries,allocated*sizeof(Entry));
+	}
+	memset(&entries[count],0,sizeof(Entry));
+	entries[count++].path=strdup(path);
+	return 0;
+}
+
+static int compare(const void* a,const void* b)
+{
+	return strcmp(((const Entry*) a)->path,((const Entry*) b)->path);
+}
+
+static void indexfile(Entry* e)
+{
+	char dir[MAX_PATH],*p;
+	L9Context *ctx=NewContext();
+
+	e->crc=filecrc(e->path,&e->size);
+	e->type=-1;
+	if (ctx==NULL || strlen(e->path)>=MAX_PATH-5) return;
+
+	SetContext(ctx);
+	SetScanCache(writecache);
+	SetPreloadLimit(0);
+	if (LoadGame(e->path,NULL))
+	{
+		e->type=ctx->L9GameType;
+		e->offset=ctx->startdata-ctx->startfile;
+		e->msgtype=ctx->L9MsgType;
+		e->pictures=ctx->picturedata ? ctx->picturesize : 0;
+		e->name=GetGameName();
+
+		/* bitmaps are looked for beside the game */
+		strcpy(dir,e->path);
+		p=strrchr(dir,'/');
+		p=p ? p+1 : dir;
+		*p=0;
+		e->bitmaps=DetectBitmaps(dir);
+	}
+	SetContext(NULL);
+	FreeContext(ctx);
+}
+
+static void* worker(void* arg)
+{
+	int i;
+
+	while (TRUE)
+	{
+		pthread_mutex_lock(&mutex);
+		i=next++;
+		pthread_mutex_unlock(&mutex);
+		if (i>=count) return NULL;
+		indexfile(&entries[i]);
+	}
+}
+
+static void jsonstring(const char* s)
+{
+	putchar('"');
+	for (;*s;s++)
+	{
+		if (*s=='"' || *s=='\\') printf("\\%c",*s);
+		else if ((unsigned char) *s<0x20) printf("\\u%04x",*s);
+		else putchar(*s);
+	}
+	putchar('"');
+}
+
+static void csvstring(const char* s)
+{
+	putchar('"');
+	for (;*s;s++)
+	{
+		if (*s=='"') putchar('"');
+		putchar(*s);
+	}
+	putchar('"');
+}
+
+static void printjson(L9BOOL all)
+{
+	L9BOOL first=TRUE;
+	Entry *e;
+	int i;
+
+	printf("[");
+	for (i=0;i<count;i++)
+	{
+		e=&entries[i];
+		if (e->type<0 && !all) continue;
+		printf(first ? "\n" : ",\n");
+		first=FALSE;
+		printf("  {\"path\": ");
+		jsonstring(e->path);
+		printf(", \"size\": %lu, \"crc32\": \"%08lx\"",(unsigned long) e->size,(unsigned long) e->crc);
+		if (e->type<0)
+		{
+			printf(", \"type\": null}");
+			continue;
+		}
+		printf(", \"type\": \"%s\", \"offset\": %ld",types[e->type],e->offset);
+		if (e->type<=1) printf(", \"msgtype\": \"%s\"",types[e->msgtype]);
+		printf(", \"pictures\": %lu",(unsigned long) e->pictures);
+		if (e->bitmaps!=NO_BITMAPS) printf(", \"bitmaps\": \"%s\"",bitmaps[e->bitmaps]);
+		if (e->name)
+		{
+			printf(", \"name\": ");
+			jsonstring(e->name);
+		}
+		printf("}");
+	}
+	printf(first ? "]\n" : "\n]\n");
+}
+
+static void printcsv(L9BOOL all)
+{
+	Entry *e;
+	int i;
+
+	printf("path,size,crc32,type,offset,msgtype,pictures,bitmaps,name\n");
+	for (i=0;i<count;i++)
+	{
+		e=&entries[i];
+		if (e->type<0 && !all) continue;
+		csvstring(e->path);
+		printf(",%lu,%08lx",(unsigned long) e->size,(unsigned long) e->crc);
+		if (e->type<0)
+		{
+			printf(",,,,,,\n");
+			continue;
+		}
+		printf(",%s,%ld,%s,%lu,%s,",types[e->type],e->offset,
+			e->type<=1 ? types[e->msgtype] : "",(unsigned long) e->pictures,bitmaps[e->bitmaps]);
+		if (e->name) csvstring(e->name);
+		printf("\n");
+	}
+}
+
+static void usage(char* name)
+{
+	fprintf(stderr,"Use: %s [-a] [-c] [-f json|csv] [-j threads] <path> ...\n",name);
+}
+
+int main(int argc,char** argv)
+{
+	pthread_t *threads;
+	L9BOOL all=FALSE,csv=FALSE;
+	int nthreads=(int) sysconf(_SC_NPROCESSORS_ONLN);
+	int i;
+
+	for (i=1;i<argc && argv[i][0]=='-';i++)
+	{
+		if (strcmp(argv[i],"-a")==0)
+			all=TRUE;
+		else if (strcmp(argv[i],"-c")==0)
+			writecache=TRUE;
+		else if (strcmp(argv[i],"-f")==0 && i+1<argc)
+			csv=strcmp(argv[++i],"csv")==0;
+		else if (strcmp(argv[i],"-j")==0 && i+1<argc)
+			nthreads=atoi(argv[++i]);
+		else
+			break;
+	}
+	if (i>=argc || argv[i][0]=='-')
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	if (nthreads<1) nthreads=1;
+
+	for (;i<argc;i++)
+	{
+		if (nftw(argv[i],addfile,16,FTW_PHYS)!=0)
+			fprintf(stderr,"Unable to read %s\n",argv[i]);
+	}
+	qsort(entries,count,sizeof(Entry),compare);
+
+	/* the scans that LoadGame() runs use threads of their own as well */
+	makecrctable();
+	if (nthreads>count) nthreads=count;
+	threads=malloc(nthreads*sizeof(pthread_t));
+	for (i=0;i<nthreads;i++) pthread_create(&threads[i],NULL,worker,NULL);
+	for (i=0;i<nthreads;i++) pthread_join(threads[i],NULL);
+
+	if (csv) printcsv(all); else printjson(all);
+	for (i=0;i<count;i++) free(entries[i].path);
+	free(entries);
+	free(threads);
+	return 0;
+}
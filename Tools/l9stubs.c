@@ -0,0 +1,42 @@
+/***********************************************************************\
+*
+* Level 9 interpreter
+* Interface routines for tools that only use the interpreter to load
+* games. Messages go to stderr and everything else does nothing.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+*
+\***********************************************************************/
+
+#include <stdio.h>
+#include "level9.h"
+
+void os_printchar(char c) { fputc(c=='\r' ? '\n' : c,stderr); }
+L9BOOL os_input(char* ibuff, int size) { return FALSE; }
+char os_readchar(int millis) { return 0; }
+L9BOOL os_stoplist(void) { return FALSE; }
+void os_flush(void) { }
+L9BOOL os_save_file(L9BYTE* Ptr, int Bytes) { return FALSE; }
+L9BOOL os_load_file(L9BYTE* Ptr, int* Bytes, int Max) { return FALSE; }
+L9BOOL os_get_game_file(char* NewName, int Size) { return FALSE; }
+void os_set_filenumber(char* NewName, int Size, int n) { }
+void os_graphics(int mode) { }
+void os_cleargraphics(void) { }
+void os_setcolour(int colour, int index) { }
+void os_drawline(int x1, int y1, int x2, int y2, int colour1, int colour2) { }
+void os_fill(int x, int y, int colour1, int colour2) { }
+void os_show_bitmap(int pic, int x, int y) { }
+FILE* os_open_script_file(void) { return NULL; }
+L9BOOL os_find_file(char* NewName) { return FALSE; }
@@ -0,0 +1,244 @@
+/***********************************************************************\
+*
+* Level 9 interpreter
+* Trace file decoder
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+*
+* Use: l9trace <tracefile> [gamefile]
+*
+* Prints a trace file recorded with the #trace command as text, one
+* line per opcode. Given the game file as well, the operands that the
+* trace does not hold (constants, list offsets and branch targets) are
+* read from the game, and branches show whether they were taken.
+*
+\***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "level9.h"
+#include "l9context.h"
+
+#define TRACERECSIZE 16
+#define TRACEVAR 1
+#define TRACEVAR2 2
+
+typedef struct
+{
+	L9UINT32 pc;
+	int code,flags,stack,var,var2;
+	L9UINT16 value,value2;
+} Record;
+
+static L9BYTE* Code=NULL;	/* A-code of the game, if loaded */
+static L9UINT32 CodeSize=0;
+
+static char *codes[]=
+{
+	"Goto","intgosub","intreturn","printnumber","messagev","messagec",
+	"function","input","varcon","varvar","_add","_sub","ilins","ilins",
+	"jump","Exit","ifeqvt","ifnevt","ifltvt","ifgtvt","screen","cleartg",
+	"picture","getnextobject","ifeqct","ifnect","ifltct","ifgtct",
+	"printinput","ilins","ilins","ilins"
+};
+static char *functions[]=
+{
+	"calldriver","L9Random","save","restore","clearworkspace","clearstack"
+};
+static char *compare[]={"=","!=","<",">"};
+
+static L9BOOL readrecord(FILE* f,Record* r)
+{
+	L9BYTE b[TRACERECSIZE];
+	if (fread(b,1,TRACERECSIZE,f)!=TRACERECSIZE) return FALSE;
+	r->pc=b[0]|(b[1]<<8)|((L9UINT32) b[2]<<16)|((L9UINT32) b[3]<<24);
+	r->code=b[4];
+	r->flags=b[5];
+	r->stack=b[6]|(b[7]<<8);
+	r->var=b[8];
+	r->var2=b[9];
+	r->value=b[10]|(b[11]<<8);
+	r->value2=b[12]|(b[13]<<8);
+	return TRUE;
+}
+
+/* reads operands from the game, as getaddr() and getcon() would */
+static L9UINT32 getaddr(int code,L9UINT32* pos)
+{
+	L9UINT32 a;
+	if (code&0x20)
+	{
+		a=*pos+(signed char) Code[*pos];
+		(*pos)++;
+	}
+	else
+	{
+		a=L9WORD(Code+*pos);
+		(*pos)+=2;
+	}
+	return a;
+}
+
+static L9UINT16 getcon(int code,L9UINT32* pos)
+{
+	L9UINT16 c;
+	if (code&0x40) return Code[(*pos)++];
+	c=L9WORD(Code+*pos);
+	(*pos)+=2;
+	return c;
+}
+
+/* prints the detail for one opcode; next is the opcode run after it,
+   or NULL at the end of the trace */
+static void detail(Record* r,Record* next)
+{
+	int c=r->code;
+	L9UINT32 pos=r->pc+1,target;
+	L9UINT16 con;
+	L9BOOL known=Code!=NULL && r->pc+8<=CodeSize;
+
+	if (c&0x80)
+	{
+		int list=c&0x1f;
+		if (c>=0xe0)
+			printf(" list %d [%d]=Var[%d] (=%d)",list,r->value2,r->var,r->value);
+		else if (c>=0xc0)
+		{
+			if (known) printf(" Var[%d]= list %d [%d]) (=%d)",r->var,list,Code[pos],r->value);
+			else printf(" Var[%d]= list %d (=%d)",r->var,list,r->value);
+		}
+		else if (c>=0xa0)
+			printf(" Var[%d] =list %d [%d] (=%d)",r->var,list,r->value2,r->value);
+		else if (known)
+			printf(" list %d [%d]=Var[%d] (=%d)",list,Code[pos],r->var,r->value);
+		else
+			printf(" list %d =Var[%d] (=%d)",list,r->var,r->value);
+		return;
+	}
+
+	switch (c&0x1f)
+	{
+		case 6: /* function */
+			if (known)
+			{
+				int d0=Code[pos];
+				if (d0==250) printf(" printstr");
+				else if (d0>=1 && d0<=6) printf(" %s",functions[d0-1]);
+			}
+			return;
+		case 8: /* varcon */
+			printf(" Var[%d]=%d)",r->var,r->value);
+			return;
+		case 9: /* varvar */
+			printf(" Var[%d]=Var[%d] (=%d)",r->var,r->var2,r->value);
+			return;
+		case 10: /* _add */
+			printf(" Var[%d]+=Var[%d] (+=%d)",r->var,r->var2,r->value2);
+			return;
+		case 11: /* _sub */
+			printf(" Var[%d]-=Var[%d] (-=%d)",r->var,r->var2,r->value2);
+			return;
+		case 16: /* ifeqvt */
+		case 17: /* ifnevt */
+		case 18: /* ifltvt */
+		case 19: /* ifgtvt */
+			printf(" if Var[%d]%sVar[%d]",r->var,compare[c&3],r->var2);
+			if (known)
+			{
+				pos+=2;
+				target=getaddr(c,&pos);
+				printf(" goto %ld",(long) target);
+				if (next) printf(" (%s)",next->pc==target ? "Yes" : "No");
+			}
+			return;
+		case 24: /* ifeqct */
+		case 25: /* ifnect */
+		case 26: /* ifltct */
+		case 27: /* ifgtct */
+			if (known)
+			{
+				pos++;
+				con=getcon(c,&pos);
+				target=getaddr(c,&pos);
+				printf(" if Var[%d]%s%d goto %ld",r->var,compare[c&3],con,(long) target);
+				if (next) printf(" (%s)",next->pc==target ? "Yes" : "No");
+			}
+			else
+				printf(" if Var[%d]%s",r->var,compare[c&3]);
+			return;
+	}
+	if (r->flags&TRACEVAR) printf(" Var[%d]=%d",r->var,r->value);
+}
+
+static void print(Record* r,Record* next)
+{
+	printf("%ld (s:%d) %x",(long) r->pc,r->stack,r->code);
+	if (!(r->code&0x80))
+		printf(" = %s",codes[r->code&0x1f]);
+	detail(r,next);
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	L9BYTE header[8];
+	Record r[2];
+	L9BOOL have;
+	int cur=0;
+	FILE* f;
+
+	if (argc!=2 && argc!=3)
+	{
+		fprintf(stderr,"Use: %s <tracefile> [gamefile]\n",argv[0]);
+		return 1;
+	}
+	if ((f=fopen(argv[1],"rb"))==NULL)
+	{
+		fprintf(stderr,"Error: Unable to open %s\n",argv[1]);
+		return 1;
+	}
+	if (fread(header,1,8,f)!=8 || memcmp(header,"L9TR",4)!=0 || header[5]!=TRACERECSIZE)
+	{
+		fprintf(stderr,"Error: %s is not a trace file\n",argv[1]);
+		return 1;
+	}
+	if (argc==3)
+	{
+		if (!LoadGame(argv[2],NULL))
+		{
+			fprintf(stderr,"Error: Unable to load game file %s\n",argv[2]);
+			return 1;
+		}
+		Code=l9ctx->acodeptr;
+		CodeSize=l9ctx->FileSize-(l9ctx->acodeptr-l9ctx->startdata);
+	}
+
+	printf("Code follow file...\n");
+	have=readrecord(f,&r[cur]);
+	while (have)
+	{
+		L9BOOL more=readrecord(f,&r[1-cur]);
+		print(&r[cur],more ? &r[1-cur] : NULL);
+		cur=1-cur;
+		have=more;
+	}
+	fclose(f);
+	if (Code)
+	{
+		StopGame();
+		FreeMemory();
+	}
+	return 0;
+}
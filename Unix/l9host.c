@@ -0,0 +1,597 @@
+/*
+ * Multi-session Unix host for the Level 9 interpreter
+ *
+ * Runs many games in one process, one for each connection on a
+ * Unix-domain socket or a TCP port on the loopback interface, with a
+ * single epoll loop waiting on all of them:
+ *
+ *   l9host [-u path] [-t port] [-m] <gamefile>
+ *
+ * The game is loaded once and run up to its first input, and each
+ * connection gets a clone of that L9Context, so starting a session
+ * costs a copy rather than a load. Games run with resumable input: a
+ * session runs in slices until the game
+ * asks for a line that has not arrived yet, and is then parked until
+ * the client sends one for L9SupplyInput(). A game waiting for a key is
+ * given "no key" for a while, as generic.c does, before being parked in
+ * the same way. Sessions that can run take turns a slice at a time, so
+ * one busy game does not hold up the others.
+ *
+ * With -m, a NUL byte is sent each time a session parks for a line, so
+ * that a program driving the host (see l9load.c) knows when to send
+ * the next command. Games are saved to and restored from memory kept
+ * with the session, and the session ends when the game stops or the
+ * client closes the connection.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "level9.h"
+#include "l9context.h"
+
+#define SLICESIZE 4096
+#define INBUFSIZE 1024
+#define MAXEVENTS 64
+#define WAITKEYCALLS 1024
+
+typedef struct Session
+{
+	int fd;
+	L9Context *ctx;
+	char in[INBUFSIZE];
+	int inlen;
+	char *out;
+	int outlen,outsize;
+	int waiting;		/* parked until the client sends more */
+	L9RunReason need;	/* what the game is waiting for */
+	int keycalls;		/* key waits since the last key */
+	int closing;		/* client has gone, or the game stopped */
+	L9BYTE *save;
+	int savesize;
+	struct Session *next;	/* in the run queue */
+	int queued;
+} Session;
+
+static int epfd;
+static int marker = 0;
+static Session *current = NULL;
+static Session *runhead = NULL, *runtail = NULL;
+static int sessions = 0;
+
+/* the game that sessions are cloned from, and what it printed */
+static L9Context *template;
+static L9RunReason bootreason;
+static Session boot;
+
+/* listening sockets, told apart from sessions by their address */
+static int unixfd = -1, tcpfd = -1;
+
+static void output(Session *s, const char *p, int n)
+{
+	if (s->closing || n == 0)
+		return;
+	if (s->outlen + n > s->outsize)
+	{
+		int size = s->outsize ? s->outsize : 4096;
+		char *out;
+
+		while (s->outlen + n > size)
+			size *= 2;
+		out = realloc(s->out, size);
+		if (out == NULL)
+		{
+			s->closing = 1;
+			return;
+		}
+		s->out = out;
+		s->outsize = size;
+	}
+	memcpy(s->out + s->outlen, p, n);
+	s->outlen += n;
+}
+
+/* writes what the socket will take, asking to be told when it will
+   take the rest */
+static void sendoutput(Session *s)
+{
+	struct epoll_event ev;
+	int n;
+
+	while (s->outlen > 0)
+	{
+		n = write(s->fd, s->out, s->outlen);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				s->closing = 1;
+				s->outlen = 0;
+			}
+			break;
+		}
+		memmove(s->out, s->out + n, s->outlen - n);
+		s->outlen -= n;
+	}
+	/* once the game has stopped, only wait to send the rest */
+	ev.events = (s->closing ? 0 : EPOLLIN) | (s->outlen > 0 ? EPOLLOUT : 0);
+	ev.data.ptr = s;
+	epoll_ctl(epfd, EPOLL_CTL_MOD, s->fd, &ev);
+}
+
+static void enqueue(Session *s)
+{
+	if (s->queued)
+		return;
+	s->queued = 1;
+	s->next = NULL;
+	if (runtail)
+		runtail->next = s;
+	else
+		runhead = s;
+	runtail = s;
+}
+
+static Session *dequeue(void)
+{
+	Session *s = runhead;
+
+	if (s)
+	{
+		runhead = s->next;
+		if (runhead == NULL)
+			runtail = NULL;
+		s->queued = 0;
+	}
+	return s;
+}
+
+void os_printchar(char c)
+{
+	if (c == '\r')
+		c = '\n';
+	if (c == '\n' || (c >= 32 && c < 127))
+		output(current, &c, 1);
+}
+
+/* input is given with L9SupplyInput(), so these are never called */
+L9BOOL os_input(char *ibuff, int size)
+{
+	return FALSE;
+}
+
+char os_readchar(int millis)
+{
+	return 0;
+}
+
+L9BOOL os_stoplist(void)
+{
+	return FALSE;
+}
+
+void os_flush(void)
+{
+}
+
+L9BOOL os_save_file(L9BYTE *Ptr, int Bytes)
+{
+	Session *s = current;
+	L9BYTE *save = realloc(s->save, Bytes);
+
+	if (save == NULL)
+		return FALSE;
+	memcpy(save, Ptr, Bytes);
+	s->save = save;
+	s->savesize = Bytes;
+	return TRUE;
+}
+
+L9BOOL os_load_file(L9BYTE *Ptr, int *Bytes, int Max)
+{
+	Session *s = current;
+
+	if (s->save == NULL)
+		return FALSE;
+	*Bytes = s->savesize < Max ? s->savesize : Max;
+	memcpy(Ptr, s->save, *Bytes);
+	return TRUE;
+}
+
+L9BOOL os_get_game_file(char *NewName, int Size)
+{
+	return FALSE;
+}
+
+void os_set_filenumber(char *NewName, int Size, int n)
+{
+	char *p = strrchr(NewName, '/');
+	int i;
+
+	if (p == NULL)
+		p = NewName;
+	for (i = strlen(p) - 1; i >= 0; i--)
+	{
+		if (p[i] >= '0' && p[i] <= '9')
+		{
+			p[i] = '0' + n;
+			return;
+		}
+	}
+}
+
+void os_graphics(int mode)
+{
+}
+
+void os_cleargraphics(void)
+{
+}
+
+void os_setcolour(int colour, int index)
+{
+}
+
+void os_drawline(int x1, int y1, int x2, int y2, int colour1, int colour2)
+{
+}
+
+void os_fill(int x, int y, int colour1, int colour2)
+{
+}
+
+void os_show_bitmap(int pic, int x, int y)
+{
+}
+
+FILE *os_open_script_file(void)
+{
+	return NULL;
+}
+
+L9BOOL os_find_file(char *NewName)
+{
+	FILE *f = fopen(NewName, "rb");
+
+	if (f != NULL)
+	{
+		fclose(f);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static void endsession(Session *s)
+{
+	Session *p, *prev = NULL;
+
+	for (p = runhead; p; prev = p, p = p->next)
+	{
+		if (p == s)
+		{
+			if (prev)
+				prev->next = s->next;
+			else
+				runhead = s->next;
+			if (runtail == s)
+				runtail = prev;
+			break;
+		}
+	}
+
+	epoll_ctl(epfd, EPOLL_CTL_DEL, s->fd, NULL);
+	close(s->fd);
+	SetContext(s->ctx);
+	StopGame();
+	FreeContext(s->ctx);
+	free(s->out);
+	free(s->save);
+	free(s);
+	sessions--;
+}
+
+/* gives the bound game what it is waiting for from the client's input,
+   returning FALSE if it has to wait for more */
+static int supply(Session *s)
+{
+	char line[INBUFSIZE], *nl;
+	int n;
+
+	if (s->need == L9_NEED_INPUT)
+	{
+		nl = memchr(s->in, '\n', s->inlen);
+		if (nl == NULL)
+			return FALSE;
+		n = nl - s->in;
+		memcpy(line, s->in, n);
+		if (n > 0 && line[n - 1] == '\r')
+			n--;
+		line[n] = 0;
+		n = nl + 1 - s->in;
+	}
+	else
+	{
+		/* as in generic.c, a game pausing gets no key for a while
+		   before being made to wait for one */
+		if (s->inlen == 0)
+		{
+			if (++s->keycalls < WAITKEYCALLS)
+			{
+				L9SupplyInput("");
+				return TRUE;
+			}
+			s->keycalls = 0;
+			return FALSE;
+		}
+		s->keycalls = 0;
+
+		/* take the key and the rest of its line */
+		line[0] = s->in[0] == '\n' ? '\r' : s->in[0];
+		line[1] = 0;
+		nl = memchr(s->in, '\n', s->inlen);
+		n = nl ? nl + 1 - s->in : s->inlen;
+	}
+	memmove(s->in, s->in + n, s->inlen - n);
+	s->inlen -= n;
+	L9SupplyInput(line);
+	return TRUE;
+}
+
+/* the bound game has stopped for input: give it what the client has
+   sent, or park the session until more arrives */
+static void wants(Session *s, L9RunReason reason)
+{
+	s->need = reason;
+	if (!supply(s))
+	{
+		s->waiting = 1;
+		if (marker && reason == L9_NEED_INPUT)
+			output(s, "", 1);
+	}
+}
+
+/* runs one slice of a session's game */
+static void runsession(Session *s)
+{
+	L9RunReason reason;
+
+	current = s;
+	SetContext(s->ctx);
+	if (!RunGameSlice(SLICESIZE, &reason))
+		s->closing = 1;
+	else if (reason == L9_NEED_INPUT || reason == L9_NEED_KEY)
+		wants(s, reason);
+	current = NULL;
+
+	if (s->outlen > 0)
+		sendoutput(s);
+	if (s->closing)
+	{
+		/* let the last of the output go before closing */
+		if (s->outlen == 0)
+			endsession(s);
+	}
+	else if (!s->waiting)
+		enqueue(s);
+}
+
+static void newsession(int listenfd)
+{
+	struct epoll_event ev;
+	Session *s;
+	int fd;
+
+	while ((fd = accept(listenfd, NULL, NULL)) >= 0)
+	{
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		s = calloc(1, sizeof(Session));
+		if (s == NULL || (s->ctx = CloneContext(template)) == NULL)
+		{
+			free(s);
+			close(fd);
+			continue;
+		}
+		s->fd = fd;
+		ev.events = EPOLLIN;
+		ev.data.ptr = s;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+		sessions++;
+
+		output(s, boot.out, boot.outlen);
+		current = s;
+		SetContext(s->ctx);
+		if (bootreason == L9_NEED_INPUT || bootreason == L9_NEED_KEY)
+			wants(s, bootreason);
+		current = NULL;
+		sendoutput(s);
+		if (s->closing)
+			endsession(s);
+		else if (!s->waiting)
+			enqueue(s);
+	}
+}
+
+static void readsession(Session *s)
+{
+	int n;
+
+	while (!s->closing)
+	{
+		if (s->inlen == INBUFSIZE)
+		{
+			/* a line longer than anything a game can take */
+			s->inlen = 0;
+		}
+		n = read(s->fd, s->in + s->inlen, INBUFSIZE - s->inlen);
+		if (n > 0)
+		{
+			s->inlen += n;
+			if (s->waiting)
+			{
+				SetContext(s->ctx);
+				if (supply(s))
+				{
+					s->waiting = 0;
+					enqueue(s);
+				}
+			}
+			continue;
+		}
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+			s->closing = 1;
+		break;
+	}
+	if (s->closing)
+		endsession(s);
+}
+
+static int listenon(struct sockaddr *addr, socklen_t len, int *fdp)
+{
+	struct epoll_event ev;
+	int one = 1;
+	int fd = socket(addr->sa_family, SOCK_STREAM, 0);
+
+	if (fd < 0)
+		return -1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(fd, addr, len) < 0 || listen(fd, SOMAXCONN) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	ev.events = EPOLLIN;
+	ev.data.ptr = fdp;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+	return *fdp = fd;
+}
+
+static void usage(char *name)
+{
+	printf("Use: %s [-u path] [-t port] [-m] <gamefile>\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	struct epoll_event events[MAXEVENTS];
+	char *path = NULL;
+	int port = 0;
+	int i, n;
+
+	for (i = 1; i < argc - 1 && argv[i][0] == '-'; i++)
+	{
+		if (strcmp(argv[i], "-u") == 0 && i < argc - 2)
+			path = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i < argc - 2)
+			port = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-m") == 0)
+			marker = 1;
+		else
+			break;
+	}
+	if (i != argc - 1 || (path == NULL && port == 0))
+	{
+		usage(argv[0]);
+		return 0;
+	}
+
+	/* sessions are cloned from this once it has got as far as input */
+	current = &boot;
+	template = NewContext();
+	SetContext(template);
+	SetResumableInput(TRUE);
+	if (!LoadGame(argv[i], NULL))
+	{
+		printf("Error: Unable to open game file\n");
+		return 1;
+	}
+	while (RunGameSlice(SLICESIZE, &bootreason))
+	{
+		if (bootreason == L9_NEED_INPUT || bootreason == L9_NEED_KEY)
+			break;
+	}
+	current = NULL;
+	if (bootreason == L9_RUN_STOPPED)
+	{
+		printf("Error: Game stopped before asking for input\n");
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	epfd = epoll_create1(0);
+	if (path)
+	{
+		struct sockaddr_un un;
+
+		memset(&un, 0, sizeof(un));
+		un.sun_family = AF_UNIX;
+		strncpy(un.sun_path, path, sizeof(un.sun_path) - 1);
+		unlink(path);
+		if (listenon((struct sockaddr *) &un, sizeof(un), &unixfd) < 0)
+		{
+			printf("Error: Unable to listen on %s\n", path);
+			return 1;
+		}
+	}
+	if (port)
+	{
+		struct sockaddr_in in;
+
+		memset(&in, 0, sizeof(in));
+		in.sin_family = AF_INET;
+		in.sin_port = htons(port);
+		in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (listenon((struct sockaddr *) &in, sizeof(in), &tcpfd) < 0)
+		{
+			printf("Error: Unable to listen on port %d\n", port);
+			return 1;
+		}
+	}
+
+	while (1)
+	{
+		/* only block when no game is ready to run */
+		n = epoll_wait(epfd, events, MAXEVENTS, runhead ? 0 : -1);
+		for (i = 0; i < n; i++)
+		{
+			Session *s = events[i].data.ptr;
+
+			if (events[i].data.ptr == &unixfd || events[i].data.ptr == &tcpfd)
+			{
+				newsession(*(int *) events[i].data.ptr);
+				continue;
+			}
+			if (events[i].events & EPOLLOUT)
+			{
+				sendoutput(s);
+				if (s->closing && s->outlen == 0)
+				{
+					endsession(s);
+					continue;
+				}
+			}
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				readsession(s);
+		}
+
+		/* one slice each for the sessions ready now */
+		n = sessions;
+		while (n-- > 0 && runhead)
+			runsession(dequeue());
+	}
+	return 0;
+}
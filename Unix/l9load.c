@@ -0,0 +1,299 @@
+/*
+ * Load generator for the Level 9 session host
+ *
+ * Replays scripts of commands, such as those from L9TestSuite, across
+ * many simulated clients of l9host at once, and reports how long the
+ * host took to answer:
+ *
+ *   l9host -m -u /tmp/l9.sock game.dat &
+ *   l9load [-u path] [-t port] [-n clients] [-r rounds] <script> ...
+ *
+ * Scripts are read as the #play command reads them, so a command ends
+ * at a ';' or '[' and lines starting with '#' other than #seed are left
+ * out. Client i plays script i modulo the number of scripts, sending
+ * each command once the host
+ * has sent the NUL byte that -m adds when the game asks for input, and
+ * starts again with a new connection for each of its rounds. The time
+ * from sending a command to the next NUL is its latency.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MAXEVENTS 64
+#define LINESIZE 256
+
+typedef struct
+{
+	char **lines;
+	int count;
+} Script;
+
+typedef struct
+{
+	int fd;
+	Script *script;
+	int line;		/* next line to send */
+	int rounds;		/* connections still to make */
+	double sent;	/* when the last command was sent */
+} Client;
+
+static char *path = NULL;
+static int port = 0;
+static int epfd;
+
+static double *latency = NULL;
+static int latencies = 0, latencysize = 0;
+static long bytesin = 0;
+static int sessionsdone = 0, failures = 0;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int readscript(char *name, Script *s)
+{
+	char line[LINESIZE], *end;
+	FILE *f = fopen(name, "rt");
+
+	if (f == NULL)
+		return 0;
+	s->lines = NULL;
+	s->count = 0;
+	while (fgets(line, LINESIZE, f))
+	{
+		if (line[0] == '#' && strncasecmp(line, "#seed ", 6) != 0)
+			continue;
+		if ((end = strpbrk(line, "\r\n[;")) != NULL)
+			*end = 0;
+		if (line[0] == 0)
+			continue;
+		s->lines = realloc(s->lines, (s->count + 1) * sizeof(char *));
+		s->lines[s->count] = malloc(strlen(line) + 2);
+		sprintf(s->lines[s->count++], "%s\n", line);
+	}
+	fclose(f);
+	return 1;
+}
+
+static void addlatency(double t)
+{
+	if (latencies == latencysize)
+	{
+		latencysize = latencysize ? latencysize * 2 : 4096;
+		latency = realloc(latency, latencysize * sizeof(double));
+	}
+	latency[latencies++] = t;
+}
+
+static int connectclient(Client *c)
+{
+	struct epoll_event ev;
+	int fd;
+
+	if (path)
+	{
+		struct sockaddr_un un;
+
+		memset(&un, 0, sizeof(un));
+		un.sun_family = AF_UNIX;
+		strncpy(un.sun_path, path, sizeof(un.sun_path) - 1);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, (struct sockaddr *) &un, sizeof(un)) < 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	else
+	{
+		struct sockaddr_in in;
+
+		memset(&in, 0, sizeof(in));
+		in.sin_family = AF_INET;
+		in.sin_port = htons(port);
+		in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, (struct sockaddr *) &in, sizeof(in)) < 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	if (fd < 0)
+		return 0;
+
+	c->fd = fd;
+	c->line = 0;
+	c->sent = 0;
+	c->rounds--;
+	ev.events = EPOLLIN;
+	ev.data.ptr = c;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+	return 1;
+}
+
+/* ends a connection, returning the number of clients it leaves running */
+static int endclient(Client *c)
+{
+	epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+	close(c->fd);
+	c->fd = -1;
+	sessionsdone++;
+	if (c->rounds > 0)
+	{
+		if (connectclient(c))
+			return 1;
+		failures++;
+	}
+	return 0;
+}
+
+/* the game has asked for input: send the next command, or end the round */
+static int prompt(Client *c)
+{
+	char *line;
+	int len;
+
+	if (c->sent > 0)
+		addlatency(now() - c->sent);
+	if (c->line >= c->script->count)
+		return endclient(c);
+	line = c->script->lines[c->line++];
+	len = strlen(line);
+	c->sent = now();
+	if (write(c->fd, line, len) != len)
+	{
+		failures++;
+		return endclient(c);
+	}
+	return 1;
+}
+
+static int compare(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void usage(char *name)
+{
+	printf("Use: %s [-u path] [-t port] [-n clients] [-r rounds] <script> ...\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	struct epoll_event events[MAXEVENTS];
+	char buf[4096];
+	Script *scripts;
+	Client *clients;
+	int nclients = 1, rounds = 1, nscripts, running = 0;
+	double start, elapsed, total = 0;
+	int i, j, n;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (i == argc - 1)
+			break;
+		if (strcmp(argv[i], "-u") == 0)
+			path = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0)
+			port = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-n") == 0)
+			nclients = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-r") == 0)
+			rounds = atoi(argv[++i]);
+		else
+			break;
+	}
+	if (i >= argc || (path == NULL && port == 0) || nclients < 1 || rounds < 1)
+	{
+		usage(argv[0]);
+		return 0;
+	}
+
+	nscripts = argc - i;
+	scripts = malloc(nscripts * sizeof(Script));
+	for (j = 0; j < nscripts; j++)
+	{
+		if (!readscript(argv[i + j], &scripts[j]))
+		{
+			printf("Error: Unable to read script %s\n", argv[i + j]);
+			return 1;
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	epfd = epoll_create1(0);
+	clients = calloc(nclients, sizeof(Client));
+	start = now();
+	for (i = 0; i < nclients; i++)
+	{
+		clients[i].script = &scripts[i % nscripts];
+		clients[i].rounds = rounds;
+		if (connectclient(&clients[i]))
+			running++;
+		else
+			failures++;
+	}
+
+	while (running > 0)
+	{
+		n = epoll_wait(epfd, events, MAXEVENTS, -1);
+		for (i = 0; i < n; i++)
+		{
+			Client *c = events[i].data.ptr;
+			int got = read(c->fd, buf, sizeof(buf));
+
+			if (got < 0 && (errno == EINTR || errno == EAGAIN))
+				continue;
+			if (got <= 0)
+			{
+				/* the game stopped, or the host went away */
+				if (got < 0)
+					failures++;
+				running += endclient(c) - 1;
+				continue;
+			}
+			bytesin += got;
+			/* commands are sent one at a time, so at most one NUL */
+			if (memchr(buf, 0, got))
+				running += prompt(c) - 1;
+		}
+	}
+	elapsed = now() - start;
+
+	printf("%d clients, %d sessions, %d commands in %.3fs\n",
+		nclients, sessionsdone, latencies, elapsed);
+	if (latencies > 0)
+	{
+		qsort(latency, latencies, sizeof(double), compare);
+		for (i = 0; i < latencies; i++)
+			total += latency[i];
+		printf("%.0f commands/s, %.1f KB/s of output\n",
+			latencies / elapsed, bytesin / 1024.0 / elapsed);
+		printf("latency ms: mean %.3f, median %.3f, 99%% %.3f, max %.3f\n",
+			total * 1000 / latencies, latency[latencies / 2] * 1000,
+			latency[latencies * 99 / 100] * 1000, latency[latencies - 1] * 1000);
+	}
+	if (failures > 0)
+		printf("%d failures\n", failures);
+	return failures > 0;
+}
@@ -58,6 +58,11 @@
  */
 #define REPRINT_FLUSHED_TEXT 1
 
+/*
+ * Number of opcodes run by each call to RunGameSlice()
+ */
+#define SLICE_SIZE 4096
+
 
 /*
  * #includes
@@ -72,7 +77,7 @@
  * Include definitions and prototypes for the interpreter
  */
 #include "level9.h"
-extern FILE* scriptfile;
+#include "l9context.h"
 
 /*
  * You might have to change this if not using ncurses
@@ -211,7 +216,7 @@ void os_printchar(char c)
 
   }
   
-  if ((scriptfile == NULL) && (Lines == More_lines))
+  if ((l9ctx->scriptfile == NULL) && (Lines == More_lines))
   {
     printw ("[More]");
     refresh ();
@@ -763,6 +768,7 @@ int main (int argc, char *argv [])
   char gamename [256];
   char *envbuf;
   L9BOOL gotgame;
+  char *profile = NULL;
 
   /*
    * Check byte sex
@@ -783,9 +789,20 @@ int main (int argc, char *argv [])
     exit (1);
   }
 
+  /*
+   * --profile <file> counts the opcodes run and writes them out at the end
+   */
+  if ((argc == 4) && (strcmp (argv [1], "--profile") == 0))
+  {
+    profile = argv [2];
+    argv [2] = argv [0];
+    argv += 2;
+    argc -= 2;
+  }
+
   if (argc != 2)
   {
-    fprintf (stderr, "Syntax: %s <gamefile>\n",argv[0]);
+    fprintf (stderr, "Syntax: %s [--profile <file>] <gamefile>\n",argv[0]);
     exit (1);
   }
 
@@ -866,15 +883,20 @@ int main (int argc, char *argv [])
     }
   }
 
+  if (profile != NULL)
+    ProfileStart ();
+
   /*
    * Main game loop!
    */
-  while (1)
+  while (RunGameSlice (SLICE_SIZE, NULL))
   {
-    if (!RunGame ())
-    {
-      break;
-    }
+  }
+
+  if ((profile != NULL) && !ProfileWrite (profile))
+  {
+    endwin ();
+    fprintf (stderr, "%s: couldn't write profile %s\n", argv [0], profile);
   }
 
   StopGame();
@@ -27,25 +27,22 @@
 #include <stdlib.h>
 
 #include "level9.h"
-
-extern Bitmap* bitmap;
+#include "l9context.h"
 
 L9UINT32 filelength(FILE *f);
 void L9Allocate(L9BYTE **ptr,L9UINT32 Size);
+L9BYTE* readfile(FILE *f,L9UINT32 size,L9UINT32 *mapped);
+void freefile(L9BYTE *data,L9UINT32 mapped);
 
-L9BYTE* bitmap_load(char* file, L9UINT32* size)
+/* loads a picture file, which must be freed with freefile(data,*mapped) */
+L9BYTE* bitmap_load(char* file, L9UINT32* size, L9UINT32* mapped)
 {
 	L9BYTE* data = NULL;
 	FILE* f = fopen(file,"rb");
 	if (f)
 	{
 		*size = filelength(f);
-		L9Allocate(&data,*size);
-		if (fread(data,1,*size,f) != *size)
-		{
-			free(data);
-			data = NULL;
-		}
+		data = readfile(f,*size,mapped);
 		fclose(f);
 	}
 	return data;
@@ -266,8 +263,8 @@ L9BOOL bitmap_st1_decode(char* file, int x, int y)
 	int i, xi, yi, max_x, max_y, last_block;
 	int bitplanes_row, bitmaps_row, pixel_count, get_pixels;
 
-	L9UINT32 size;
-	data = bitmap_load(file,&size);
+	L9UINT32 size, mapped;
+	data = bitmap_load(file,&size,&mapped);
 	if (data == NULL)
 		return FALSE;
 
@@ -292,26 +289,26 @@ L9BOOL bitmap_st1_decode(char* file, int x, int y)
 
 	if (max_x > MAX_BITMAP_WIDTH || max_y > MAX_BITMAP_HEIGHT)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
 	if ((x == 0) && (y == 0))
 	{
-		if (bitmap)
-			free(bitmap);
-		bitmap = bitmap_alloc(max_x,max_y);
+		if (l9ctx->bitmap)
+			free(l9ctx->bitmap);
+		l9ctx->bitmap = bitmap_alloc(max_x,max_y);
 	}
-	if (bitmap == NULL)
+	if (l9ctx->bitmap == NULL)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
-	if (x+max_x > bitmap->width)
-		max_x = bitmap->width-x;
-	if (y+max_y > bitmap->height)
-		max_y = bitmap->height-y;
+	if (x+max_x > l9ctx->bitmap->width)
+		max_x = l9ctx->bitmap->width-x;
+	if (y+max_y > l9ctx->bitmap->height)
+		max_y = l9ctx->bitmap->height-y;
 
 	for (yi = 0; yi < max_y; yi++)
 	{
@@ -324,16 +321,16 @@ L9BOOL bitmap_st1_decode(char* file, int x, int y)
 				get_pixels = 16;
 
 			pixel_count += bitmap_st1_decode_pixels(
-				bitmap->bitmap+((y+yi)*bitmap->width)+x+(xi*16),
+				l9ctx->bitmap->bitmap+((y+yi)*l9ctx->bitmap->width)+x+(xi*16),
 				data+44+(yi*bitplanes_row*2)+(xi*8),8,get_pixels);
 		}
 	}
 
-	bitmap->npalette = 16;
+	l9ctx->bitmap->npalette = 16;
 	for (i = 0; i < 16; i++)
-		bitmap->palette[i] = bitmap_pcst_colour(data[(i*2)],data[1+(i*2)]);
+		l9ctx->bitmap->palette[i] = bitmap_pcst_colour(data[(i*2)],data[1+(i*2)]);
 
-	free(data);
+	freefile(data,mapped);
 	return TRUE;
 }
 
@@ -408,8 +405,8 @@ L9BOOL bitmap_pc1_decode(char* file, int x, int y)
 	L9BYTE* data = NULL;
 	int i, xi, yi, max_x, max_y;
 
-	L9UINT32 size;
-	data = bitmap_load(file,&size);
+	L9UINT32 size, mapped;
+	data = bitmap_load(file,&size,&mapped);
 	if (data == NULL)
 		return FALSE;
 
@@ -417,41 +414,41 @@ L9BOOL bitmap_pc1_decode(char* file, int x, int y)
 	max_y = data[4]+data[5]*256;
 	if (max_x > MAX_BITMAP_WIDTH || max_y > MAX_BITMAP_HEIGHT)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
 	if ((x == 0) && (y == 0))
 	{
-		if (bitmap)
-			free(bitmap);
-		bitmap = bitmap_alloc(max_x,max_y);
+		if (l9ctx->bitmap)
+			free(l9ctx->bitmap);
+		l9ctx->bitmap = bitmap_alloc(max_x,max_y);
 	}
-	if (bitmap == NULL)
+	if (l9ctx->bitmap == NULL)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
-	if (x+max_x > bitmap->width)
-		max_x = bitmap->width-x;
-	if (y+max_y > bitmap->height)
-		max_y = bitmap->height-y;
+	if (x+max_x > l9ctx->bitmap->width)
+		max_x = l9ctx->bitmap->width-x;
+	if (y+max_y > l9ctx->bitmap->height)
+		max_y = l9ctx->bitmap->height-y;
 
 	for (yi = 0; yi < max_y; yi++)
 	{
 		for (xi = 0; xi < max_x; xi++)
 		{
-			bitmap->bitmap[(bitmap->width*(y+yi))+(x+xi)] =
+			l9ctx->bitmap->bitmap[(l9ctx->bitmap->width*(y+yi))+(x+xi)] =
 				(data[23+((yi*max_x)/2)+(xi/2)]>>((1-(xi&1))*4)) & 0x0f;
 		}
 	}
 
-	bitmap->npalette = 16;
+	l9ctx->bitmap->npalette = 16;
 	for (i = 0; i < 16; i++)
-		bitmap->palette[i] = bitmap_pc1_colour(data[6+i]);
+		l9ctx->bitmap->palette[i] = bitmap_pc1_colour(data[6+i]);
 
-	free(data);
+	freefile(data,mapped);
 	return TRUE;
 }
 
@@ -614,8 +611,8 @@ L9BOOL bitmap_pc2_decode(char* file, int x, int y)
 	L9UINT16 theBitStreamBuffer, theImageDataIndex;
 	L9BYTE* theImageFileData;
 
-	L9UINT32 size;
-	data = bitmap_load(file,&size);
+	L9UINT32 size, mapped;
+	data = bitmap_load(file,&size,&mapped);
 	if (data == NULL)
 		return FALSE;
 
@@ -623,26 +620,26 @@ L9BOOL bitmap_pc2_decode(char* file, int x, int y)
 	max_y = data[39]+data[38]*256;
 	if (max_x > MAX_BITMAP_WIDTH || max_y > MAX_BITMAP_HEIGHT)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
 	if ((x == 0) && (y == 0))
 	{
-		if (bitmap)
-			free(bitmap);
-		bitmap = bitmap_alloc(max_x,max_y);
+		if (l9ctx->bitmap)
+			free(l9ctx->bitmap);
+		l9ctx->bitmap = bitmap_alloc(max_x,max_y);
 	}
-	if (bitmap == NULL)
+	if (l9ctx->bitmap == NULL)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
-	if (x+max_x > bitmap->width)
-		max_x = bitmap->width-x;
-	if (y+max_y > bitmap->height)
-		max_y = bitmap->height-y;
+	if (x+max_x > l9ctx->bitmap->width)
+		max_x = l9ctx->bitmap->width-x;
+	if (y+max_y > l9ctx->bitmap->height)
+		max_y = l9ctx->bitmap->height-y;
 
 	/* prime the new pixel variable with the seed byte */
 	theNewPixel = data[40];
@@ -728,15 +725,15 @@ L9BOOL bitmap_pc2_decode(char* file, int x, int y)
 			/* extract the nex pixel from the table */
 			theNewPixel = (data+42)[theNewPixel];
 			/* store new pixel in the bitmap */
-			bitmap->bitmap[(bitmap->width*(y+yi))+(x+xi)] = theNewPixel;
+			l9ctx->bitmap->bitmap[(l9ctx->bitmap->width*(y+yi))+(x+xi)] = theNewPixel;
 		}
 	}
 
-	bitmap->npalette = 16;
+	l9ctx->bitmap->npalette = 16;
 	for (i = 0; i < 16; i++)
-		bitmap->palette[i] = bitmap_pcst_colour(data[4+(i*2)],data[5+(i*2)]);
+		l9ctx->bitmap->palette[i] = bitmap_pcst_colour(data[4+(i*2)],data[5+(i*2)]);
 
-	free(data);
+	freefile(data,mapped);
 	return TRUE;
 }
 
@@ -843,8 +840,8 @@ L9BOOL bitmap_amiga_decode(char* file, int x, int y)
 	L9BYTE* data = NULL;
 	int i, xi, yi, max_x, max_y, p, b;
 
-	L9UINT32 size;
-	data = bitmap_load(file,&size);
+	L9UINT32 size, mapped;
+	data = bitmap_load(file,&size,&mapped);
 	if (data == NULL)
 		return FALSE;
 
@@ -852,26 +849,26 @@ L9BOOL bitmap_amiga_decode(char* file, int x, int y)
 	max_y = (((((data[68]<<8)|data[69])<<8)|data[70])<<8)|data[71];
 	if (max_x > MAX_BITMAP_WIDTH || max_y > MAX_BITMAP_HEIGHT)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
 	if ((x == 0) && (y == 0))
 	{
-		if (bitmap)
-			free(bitmap);
-		bitmap = bitmap_alloc(max_x,max_y);
+		if (l9ctx->bitmap)
+			free(l9ctx->bitmap);
+		l9ctx->bitmap = bitmap_alloc(max_x,max_y);
 	}
-	if (bitmap == NULL)
+	if (l9ctx->bitmap == NULL)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
-	if (x+max_x > bitmap->width)
-		max_x = bitmap->width-x;
-	if (y+max_y > bitmap->height)
-		max_y = bitmap->height-y;
+	if (x+max_x > l9ctx->bitmap->width)
+		max_x = l9ctx->bitmap->width-x;
+	if (y+max_y > l9ctx->bitmap->height)
+		max_y = l9ctx->bitmap->height-y;
 
 	for (yi = 0; yi < max_y; yi++)
 	{
@@ -880,15 +877,15 @@ L9BOOL bitmap_amiga_decode(char* file, int x, int y)
 			p = 0;
 			for (b = 0; b < 5; b++)
 				p |= ((data[72+(max_x/8)*(max_y*b+yi)+xi/8]>>(7-(xi%8)))&1)<<b;
-			bitmap->bitmap[(bitmap->width*(y+yi))+(x+xi)] = p;
+			l9ctx->bitmap->bitmap[(l9ctx->bitmap->width*(y+yi))+(x+xi)] = p;
 		}
 	}
 
-	bitmap->npalette = 32;
+	l9ctx->bitmap->npalette = 32;
 	for (i = 0; i < 32; i++)
-		bitmap->palette[i] = bitmap_amiga_colour(data[i*2],data[i*2+1]);
+		l9ctx->bitmap->palette[i] = bitmap_amiga_colour(data[i*2],data[i*2+1]);
 
-	free(data);
+	freefile(data,mapped);
 	return TRUE;
 }
 
@@ -972,8 +969,8 @@ L9BOOL bitmap_mac_decode(char* file, int x, int y)
 	L9BYTE* data = NULL;
 	int xi, yi, max_x, max_y;
 
-	L9UINT32 size;
-	data = bitmap_load(file,&size);
+	L9UINT32 size, mapped;
+	data = bitmap_load(file,&size,&mapped);
 	if (data == NULL)
 		return FALSE;
 
@@ -981,7 +978,7 @@ L9BOOL bitmap_mac_decode(char* file, int x, int y)
 	max_y = data[7]+data[6]*256;
 	if (max_x > MAX_BITMAP_WIDTH || max_y > MAX_BITMAP_HEIGHT)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
@@ -990,39 +987,39 @@ L9BOOL bitmap_mac_decode(char* file, int x, int y)
 
 	if ((x == 0) && (y == 0))
 	{
-		if (bitmap)
-			free(bitmap);
-		bitmap = bitmap_alloc(max_x,max_y);
+		if (l9ctx->bitmap)
+			free(l9ctx->bitmap);
+		l9ctx->bitmap = bitmap_alloc(max_x,max_y);
 	}
-	if (bitmap == NULL)
+	if (l9ctx->bitmap == NULL)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
-	if (x+max_x > bitmap->width)
-		max_x = bitmap->width-x;
-	if (y+max_y > bitmap->height)
-		max_y = bitmap->height-y;
+	if (x+max_x > l9ctx->bitmap->width)
+		max_x = l9ctx->bitmap->width-x;
+	if (y+max_y > l9ctx->bitmap->height)
+		max_y = l9ctx->bitmap->height-y;
 
 	for (yi = 0; yi < max_y; yi++)
 	{
 		for (xi = 0; xi < max_x; xi++)
 		{
-			bitmap->bitmap[(bitmap->width*(y+yi))+(x+xi)] = 
+			l9ctx->bitmap->bitmap[(l9ctx->bitmap->width*(y+yi))+(x+xi)] = 
 				(data[10+(max_x/8)*yi+xi/8]>>(7-(xi%8)))&1;
 		}
 	}
 
-	bitmap->npalette = 2;
-	bitmap->palette[0].red = 0;
-	bitmap->palette[0].green = 0;
-	bitmap->palette[0].blue = 0;
-	bitmap->palette[1].red = 0xff;
-	bitmap->palette[1].green = 0xff;
-	bitmap->palette[1].blue = 0xff;
+	l9ctx->bitmap->npalette = 2;
+	l9ctx->bitmap->palette[0].red = 0;
+	l9ctx->bitmap->palette[0].green = 0;
+	l9ctx->bitmap->palette[0].blue = 0;
+	l9ctx->bitmap->palette[1].red = 0xff;
+	l9ctx->bitmap->palette[1].green = 0xff;
+	l9ctx->bitmap->palette[1].blue = 0xff;
 
-	free(data);
+	freefile(data,mapped);
 	return TRUE;
 }
 
@@ -1170,8 +1167,8 @@ L9BOOL bitmap_c64_decode(char* file, BitmapType type, int num)
 	int i, xi, yi, max_x, max_y, cx, cy, px, py, p;
 	int off, off_scr, off_col, off_bg, col_comp;
 
-	L9UINT32 size;
-	data = bitmap_load(file,&size);
+	L9UINT32 size, mapped;
+	data = bitmap_load(file,&size,&mapped);
 	if (data == NULL)
 		return FALSE;
 
@@ -1281,12 +1278,12 @@ L9BOOL bitmap_c64_decode(char* file, BitmapType type, int num)
 			return FALSE;
 	}
 
-	if (bitmap)
-		free(bitmap);
-	bitmap = bitmap_alloc(max_x,max_y);
-	if (bitmap == NULL)
+	if (l9ctx->bitmap)
+		free(l9ctx->bitmap);
+	l9ctx->bitmap = bitmap_alloc(max_x,max_y);
+	if (l9ctx->bitmap == NULL)
 	{
-		free(data);
+		freefile(data,mapped);
 		return FALSE;
 	}
 
@@ -1321,16 +1318,16 @@ L9BOOL bitmap_c64_decode(char* file, BitmapType type, int num)
 				break;
 			}
 
-			bitmap->bitmap[(bitmap->width*yi)+(xi*2)] = i;
-			bitmap->bitmap[(bitmap->width*yi)+(xi*2)+1] = i;
+			l9ctx->bitmap->bitmap[(l9ctx->bitmap->width*yi)+(xi*2)] = i;
+			l9ctx->bitmap->bitmap[(l9ctx->bitmap->width*yi)+(xi*2)+1] = i;
 		}
 	}
 
-	bitmap->npalette = 16;
+	l9ctx->bitmap->npalette = 16;
 	for (i = 0; i < 16; i++)
-		bitmap->palette[i] = bitmap_c64_colours[i];
+		l9ctx->bitmap->palette[i] = bitmap_c64_colours[i];
 
-	free(data);
+	freefile(data,mapped);
 	return TRUE;
 }
 
@@ -1449,23 +1446,23 @@ L9BOOL bitmap_bbc_decode(char* file, BitmapType type, int num)
 	/* Convert the image. Each BBC pixel is represented by two pixels here */
 	i = 0;
 	isOddRow = 0;
-	for (j = 0; j < bitmap->height; j++)
+	for (j = 0; j < l9ctx->bitmap->height; j++)
 	{
 		isOddColumn = 0;
-		for (k = 0; k < bitmap->width/2; k++)
+		for (k = 0; k < l9ctx->bitmap->width/2; k++)
 		{
-			pixel = bitmap->bitmap[i];
-			bitmap->bitmap[i] = patArray[pixel][isOddColumn][isOddRow];
-			bitmap->bitmap[i+1] = patArray[pixel][isOddColumn][isOddRow];
+			pixel = l9ctx->bitmap->bitmap[i];
+			l9ctx->bitmap->bitmap[i] = patArray[pixel][isOddColumn][isOddRow];
+			l9ctx->bitmap->bitmap[i+1] = patArray[pixel][isOddColumn][isOddRow];
 			isOddColumn ^= 1;
 			i += 2;
 		}
 		isOddRow ^= 1;
 	}
 
-	bitmap->npalette = 8;
+	l9ctx->bitmap->npalette = 8;
 	for (i = 0; i < 8; i++)
-		bitmap->palette[i] = bitmap_bbc_colours[i];
+		l9ctx->bitmap->palette[i] = bitmap_bbc_colours[i];
 
 	return TRUE;
 }
@@ -1512,7 +1509,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_pc1_decode(file,x,y))
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 
@@ -1521,7 +1518,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_pc2_decode(file,x,y))
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 
@@ -1530,7 +1527,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_amiga_decode(file,x,y))
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 
@@ -1539,7 +1536,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_c64_decode(file,type,num))
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 
@@ -1548,7 +1545,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_bbc_decode(file,type,num))
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 
@@ -1557,7 +1554,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_c64_decode(file,type,num)) /* Nearly identical to C64 */
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 
@@ -1566,7 +1563,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_mac_decode(file,x,y))
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 
@@ -1575,7 +1572,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_st1_decode(file,x,y))
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 
@@ -1584,7 +1581,7 @@ Bitmap* DecodeBitmap(char* dir, BitmapType type, int num, int x, int y)
 		if (os_find_file(file))
 		{
 			if (bitmap_pc2_decode(file,x,y))
-				return bitmap;
+				return l9ctx->bitmap;
 		}
 		break;
 	}
@@ -24,9 +24,24 @@
 
 #include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "level9.h"
 
+/* the zygote launcher needs fork() and Unix-domain sockets */
+#if defined(__unix__) || defined(__APPLE__)
+#define ZYGOTE
+#endif
+
+#ifdef ZYGOTE
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
 #define TEXTBUFFER_SIZE 10240
 char TextBuffer[TEXTBUFFER_SIZE+1];
 int TextBufferPtr = 0;
@@ -34,6 +49,8 @@ int TextBufferPtr = 0;
 int Column = 0;
 #define SCREENWIDTH 76
 
+#define SLICESIZE 4096
+
 void os_printchar(char c)
 {
 	if (c == '\r')
@@ -55,7 +72,13 @@ L9BOOL os_input(char *ibuff, int size)
 char *nl;
 
 	os_flush();
-	fgets(ibuff, size, stdin);
+	fflush(stdout);
+	if (fgets(ibuff, size, stdin) == NULL)
+	{
+		/* no more input, so nothing more can happen */
+		StopGame();
+		return FALSE;
+	}
 	nl = strchr(ibuff, '\n');
 	if (nl)
 		*nl = 0;
@@ -68,6 +91,7 @@ char os_readchar(int millis)
 	char c;
 
 	os_flush();
+	fflush(stdout);
 	if (millis == 0)
 		return 0;
 
@@ -91,9 +115,16 @@ char os_readchar(int millis)
 	c = getc(stdin); /* will require enter key as well */
 	if (c != '\n')
 	{
-		while (getc(stdin) != '\n')
+		int d;
+
+		while ((d = getc(stdin)) != '\n')
 		{
 			/* unbuffer input until enter key */
+			if (d == EOF)
+			{
+				StopGame();
+				return 0;
+			}
 		}
 	}
 
@@ -272,20 +303,200 @@ L9BOOL os_find_file(char* NewName)
 	return FALSE;
 }
 
+#ifdef ZYGOTE
+/* reaps the games that have finished as they finish, so that none is
+   left waiting for the next connection */
+static void OnChildExit(int sig)
+{
+	int saved = errno;
+
+	while (waitpid(-1, NULL, WNOHANG) > 0);
+	errno = saved;
+}
+
+/* Loads the game once, runs it up to its first input and then forks a
+   copy of the process for each connection to the control socket, with
+   the connection as its standard input and output. The copies share the
+   loaded game until they write to it, so each starts at once. Returns
+   in the child, with the game ready to carry on, and never in the
+   zygote itself. */
+static L9BOOL Zygote(char *path, char *gamefile, char *picfile)
+{
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	L9RunReason reason = L9_RUN_STOPPED;
+	L9BOOL loaded;
+	FILE *intro;
+	char *introtext;
+	long introsize;
+	int listenfd, fd, saved;
+	pid_t pid;
+
+	/* run the game to its first input, keeping what it prints for
+	   each child to send */
+	fflush(stdout);
+	intro = tmpfile();
+	saved = dup(1);
+	if (intro == NULL || saved < 0)
+		return FALSE;
+	dup2(fileno(intro), 1);
+	SetResumableInput(TRUE);
+	/* the threads loading the other parts would not be in the children */
+	SetPreloadLimit(0);
+	loaded = LoadGame(gamefile, picfile);
+	if (loaded)
+	{
+		while (RunGameSlice(SLICESIZE, &reason))
+		{
+			if (reason == L9_NEED_INPUT || reason == L9_NEED_KEY)
+				break;
+		}
+	}
+	os_flush();
+	fflush(stdout);
+	dup2(saved, 1);
+	close(saved);
+	if (!loaded)
+	{
+		printf("Error: Unable to open game file\n");
+		return FALSE;
+	}
+	if (reason != L9_NEED_INPUT && reason != L9_NEED_KEY)
+	{
+		printf("Error: Game stopped before asking for input\n");
+		return FALSE;
+	}
+	introsize = ftell(intro);
+	introtext = malloc(introsize + 1);
+	rewind(intro);
+	if (introtext == NULL || fread(introtext, 1, introsize, intro) != (size_t) introsize)
+		return FALSE;
+	fclose(intro);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	unlink(path);
+	listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenfd < 0 || bind(listenfd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+		|| listen(listenfd, SOMAXCONN) < 0)
+	{
+		printf("Error: Unable to listen on %s\n", path);
+		return FALSE;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = OnChildExit;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGCHLD, &sa, NULL);
+	fprintf(stderr, "Zygote %d ready on %s\n", (int) getpid(), path);
+
+	while (1)
+	{
+		fd = accept(listenfd, NULL, NULL);
+		if (fd < 0)
+		{
+			if (errno != EINTR)
+				perror("accept");
+			continue;
+		}
+		pid = fork();
+		if (pid == 0)
+		{
+			/* the child plays the game over the connection */
+			signal(SIGCHLD, SIG_DFL);
+			close(listenfd);
+			dup2(fd, 0);
+			dup2(fd, 1);
+			close(fd);
+			clearerr(stdin);
+			fwrite(introtext, 1, introsize, stdout);
+			free(introtext);
+			/* back to reading stdin, from the input the game stopped at */
+			SetResumableInput(FALSE);
+			return TRUE;
+		}
+		if (pid < 0)
+			perror("fork");
+		else
+			fprintf(stderr, "Game %d started\n", (int) pid);
+		close(fd);
+	}
+}
+#endif
+
 int main(int argc, char **argv)
 {
-	printf("Level 9 Interpreter\n\n");
-	if (argc != 2)
+	char* profile=NULL;
+	char* zygote=NULL;
+	L9BOOL loadstats=FALSE;
+	int i;
+
+	for (i = 1; i < argc && strncmp(argv[i],"--",2) == 0; i++)
+	{
+		if (strcmp(argv[i],"--rescan") == 0)
+			SetRescan(TRUE);
+		else if (strcmp(argv[i],"--scan-cache") == 0)
+			SetScanCache(TRUE);
+		else if (strcmp(argv[i],"--load-stats") == 0)
+		{
+			SetLoadStats(TRUE);
+			loadstats = TRUE;
+		}
+		else if (strcmp(argv[i],"--window") == 0 && i+1 < argc)
+			SetScanWindow(atol(argv[++i])*1024);
+		else if (strcmp(argv[i],"--preload") == 0 && i+1 < argc)
+			SetPreloadLimit(atol(argv[++i])*1024);
+		else if (strcmp(argv[i],"--profile") == 0 && i+1 < argc)
+			profile = argv[++i];
+#ifdef ZYGOTE
+		else if (strcmp(argv[i],"--zygote") == 0 && i+1 < argc)
+			zygote = argv[++i];
+#endif
+		else
+			break;
+	}
+	if (zygote == NULL)
+		printf("Level 9 Interpreter\n\n");
+	if (i >= argc || argc-i > 2 || strncmp(argv[i],"--",2) == 0)
 	{
-		printf("Use: %s <gamefile>\n",argv[0]);
+		printf("Use: %s [--rescan] [--scan-cache] [--load-stats] [--window <KB>] [--preload <KB>]\n",argv[0]);
+#ifdef ZYGOTE
+		printf("          [--profile <file>] [--zygote <socket>] <gamefile> [<picturefile>]\n");
+#else
+		printf("          [--profile <file>] <gamefile> [<picturefile>]\n");
+#endif
 		return 0;
 	}
-	if (!LoadGame(argv[1],NULL))
+#ifdef ZYGOTE
+	if (zygote)
+	{
+		if (!Zygote(zygote,argv[i],i+1 < argc ? argv[i+1] : NULL))
+			return 1;
+	}
+	else
+#endif
+	if (!LoadGame(argv[i],i+1 < argc ? argv[i+1] : NULL))
 	{
 		printf("Error: Unable to open game file\n");
 		return 0;
 	}
-	while (RunGame());
+	if (profile)
+		ProfileStart();
+	while (RunGameSlice(SLICESIZE,NULL));
+	if (profile)
+	{
+		ProfileReport();
+		if (!ProfileWrite(profile))
+			printf("Error: Unable to write profile %s\n",profile);
+		os_flush();
+	}
+	if (loadstats)
+	{
+		LoadStatsReport();
+		os_flush();
+	}
 	StopGame();
 	FreeMemory();
 	return 0;
@@ -0,0 +1,375 @@
+/***********************************************************************\
+*
+* Level 9 interpreter
+* Version 5.2
+* Copyright (c) 1996-2023 Glen Summers and contributors.
+* Contributions from David Kinder, Alan Staniforth, Simon Baldwin,
+* Dieter Baron and Andreas Scherrer.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+*
+* The state of one game, for the interpreter and code that works
+* closely with it. Include this after level9.h.
+*
+* Everything that changes while a game runs is kept in an L9Context,
+* so that one process can run many games. The interpreter works on the
+* context bound with SetContext(), which is separate for each thread.
+*
+* Define L9CONTEXT_NAMES before including this file to refer to the
+* fields of the bound context by their plain names, as level9.c does.
+* Other code should use l9ctx->name, as the plain names are common
+* words such as code and object.
+*
+\***********************************************************************/
+
+/* ValidateSequence() marks the opcodes it walks in a map with a bit for
+   each byte of the game, which Tools/l9aot also reads */
+#define IMAGESIZE(n) (((n)+7)>>3)
+#define IMAGETEST(Image,p) ((Image)[(p)>>3]&(1<<((p)&7)))
+#define IMAGEMARK(Image,p) ((Image)[(p)>>3]|=1<<((p)&7))
+
+/* a mapped game file is written to a page at a time, which
+   CloneContext() copies for the pages marked in dirtymap */
+#define DIRTYPAGE 0x1000
+
+/* background threads, used to write trace files */
+#if !defined(NO_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#define L9THREADS
+#include <pthread.h>
+#define L9LOCAL __thread
+#else
+#define L9LOCAL
+#endif
+
+/* and to load the other parts of a game, see SetPreloadLimit() */
+#if defined(L9THREADS) && !defined(NO_PRELOAD)
+#define L9PRELOAD
+#endif
+
+#define IBUFFSIZE 500
+#define RAMSAVESLOTS 10
+#define GFXSTACKSIZE 100
+#define SUBINDEXSIZE 0x800	/* graphics subroutine numbers */
+#define FIRSTLINESIZE 96
+#define MSGINDEXSIZE 256	/* V1 and V2 messages whose starts are kept */
+#define PROFILEKINDS 36		/* the 32 opcodes and the four list forms */
+#define TRACEBLOCKS 8
+#define PRELOADPARTS 9		/* other parts of a game, as numbered by os_set_filenumber() */
+
+typedef struct
+{
+	L9UINT16 vartable[256];
+	L9BYTE listarea[LISTAREASIZE];
+} SaveStruct;
+
+/* what scanning a game file found, as kept in its scan cache */
+typedef struct
+{
+	L9UINT32 size,hash;				/* fingerprint of the game file */
+	L9UINT32 picfilesize,picfilehash;	/* and of the picture file, if any */
+	long offset;
+	int gametype,msgtype,v1game;
+	long acode,dict;				/* V1 only, from the start of the file */
+	long picoffset;					/* -1 if no pictures were found */
+	L9UINT32 picsize;
+	int gfx;						/* -1 until the game has shown its title */
+	L9BOOL hashed;					/* the hashes have been worked out */
+} ScanResult;
+
+#ifdef L9PRELOAD
+/* another part of the game, loaded and scanned in the background */
+typedef struct
+{
+	char name[MAX_PATH];
+	L9Context *ctx;	/* where it is loaded, as LoadGame() would */
+	pthread_t thread;
+} L9Preload;
+#endif
+
+struct L9Context
+{
+	/* these start other than zero, see NewContext() */
+	int FirstPicture,showtitle,L9V1Game;
+	char lastchar;
+
+	/* game data */
+	L9BYTE *startfile,*pictureaddress,*picturedata;
+	L9BOOL sharedpictures;	/* pictureaddress belongs to another context */
+	L9BYTE *startdata;
+	L9UINT32 FileSize,picturesize;
+	L9UINT32 startfilemap,picturemap;	/* sizes mapped by readfile(), or 0 */
+	L9BYTE *dirtymap;	/* pages of startfile written to, if mapped */
+	L9BYTE *L9Pointers[12];
+	L9BYTE *L9ListMin[12],*L9ListMax[12];
+	L9BYTE *absdatablock,*list2ptr,*list3ptr,*list9startptr,*acodeptr;
+	L9BYTE *startmd,*endmd,*endwdp5,*wordtable,*dictdata,*defdict;
+	L9UINT16 dictdatalen;
+	L9BYTE *startmdV2;
+	int L9GameType;
+	int L9MsgType;
+	char LastGame[MAX_PATH];
+	char FirstLine[FIRSTLINESIZE];
+	int FirstLinePos;
+	ScanResult scanresult;
+	L9BOOL Rescan;
+	L9BOOL ScanCache;	/* see SetScanCache() */
+	L9UINT32 scanmemory;	/* most scratch memory the scan had at once */
+	L9UINT32 scanwindow;	/* see SetScanWindow() */
+	L9UINT32 preloadlimit;	/* see SetPreloadLimit() */
+	L9BOOL streamed;	/* only the game's part of the file was read */
+	L9BOOL LoadStats;	/* see SetLoadStats() */
+	L9LoadStat loadstats[L9_LOAD_PHASES];
+	L9UINT32 loadmemory;	/* most memory the phase being timed has used */
+	double bootstart;
+	L9BOOL booting;		/* keeping statistics until the game asks for input */
+#ifdef L9PRELOAD
+	L9Preload preload[PRELOADPARTS];
+	int preloads;
+	L9BOOL preloading;	/* this is a part being loaded in the background */
+#endif
+
+	/* text */
+	int wordcase;
+	int unpackcount;
+	char unpackbuf[8];
+	L9BYTE *dictptr;
+	char threechars[34];
+	int unpackd3;
+	int mdtmode;
+	L9UINT32 *msgindex;	/* messages then abbreviations, see indexmessages() */
+	L9BOOL msgindexed;
+	L9UINT32 *subindex;	/* see indexsubs() */
+	L9BOOL subindexed;
+	char lastactualchar;
+	int d5;
+
+	/* running game */
+	SaveStruct ramsavearea[RAMSAVESLOTS];
+	GameState workspace;
+	L9UINT16 randomseed;
+	L9UINT16 constseed;
+	L9BOOL Running;
+	L9RunReason RunReason;
+	L9BYTE *codeptr;
+	L9BYTE code;
+	L9BYTE *list9ptr;
+	L9UINT16 gnostack[128];
+	L9BYTE gnoscratch[32];
+	int object,gnosp,numobjectfound,searchdepth,inithisearchpos;
+
+	/* input */
+	char ibuff[IBUFFSIZE];
+	L9BYTE *ibuffptr;
+	char obuff[34];
+	FILE *scriptfile;
+	L9BOOL Cheating;
+	int CheatWord;
+	GameState CheatWorkspace;
+	L9BOOL ResumableInput;
+	L9RunReason InputWait;	/* L9_NEED_INPUT or L9_NEED_KEY while parked */
+	L9BOOL InputReady;		/* ibuff or InputKey holds what was supplied */
+	char InputKey;
+
+	/* graphics */
+	int reflectflag,scale,gintcolour,option;
+	int l9textmode,drawx,drawy,screencalled;
+	L9BYTE *gfxa5;
+	Bitmap *bitmap;
+	int gfx_mode;
+	L9BYTE *GfxA5Stack[GFXSTACKSIZE];
+	int GfxA5StackPos;
+	int GfxScaleStack[GFXSTACKSIZE];
+	int GfxScaleStackPos;
+
+	/* decoded code, for PREDECODE and FUSEDOPS builds */
+	struct L9Op *irpool,**irmap,*irlegacyop;
+	int irused,irgen;
+	L9UINT32 irmapsize;
+	L9BYTE *irlow,*irhigh;
+	struct L9Switch *irswitch;
+	int irswitches;
+	L9UINT32 *FusedCount;
+
+	/* translated code, for AOTCODE builds */
+	L9BYTE *aotlow,*aothigh;
+	L9BOOL aotvalid;
+
+	/* profiling */
+	L9BOOL Profiling;
+	L9UINT32 ProfileKinds[PROFILEKINDS];
+	L9UINT32 *ProfileCounts;
+	L9UINT32 ProfileSize;
+
+	/* tracing */
+	L9BOOL Tracing;
+	FILE *tracefile;
+	L9BYTE *tracebuf;
+	int traceblock,tracepos,traceserial;
+#ifdef L9THREADS
+	int tracefull[TRACEBLOCKS];	/* records in each block waiting to be written */
+	L9BOOL tracequit;
+	pthread_t tracethread;
+	pthread_mutex_t tracemutex;
+	pthread_cond_t tracecond;
+#endif
+};
+
+/* the context the interpreter is working on */
+extern L9LOCAL L9Context* l9ctx;
+
+#ifdef L9CONTEXT_NAMES
+#define FirstPicture (l9ctx->FirstPicture)
+#define showtitle (l9ctx->showtitle)
+#define L9V1Game (l9ctx->L9V1Game)
+#define lastchar (l9ctx->lastchar)
+#define startfile (l9ctx->startfile)
+#define pictureaddress (l9ctx->pictureaddress)
+#define picturedata (l9ctx->picturedata)
+#define sharedpictures (l9ctx->sharedpictures)
+#define startdata (l9ctx->startdata)
+#define FileSize (l9ctx->FileSize)
+#define picturesize (l9ctx->picturesize)
+#define startfilemap (l9ctx->startfilemap)
+#define picturemap (l9ctx->picturemap)
+#define dirtymap (l9ctx->dirtymap)
+#define L9Pointers (l9ctx->L9Pointers)
+#define L9ListMin (l9ctx->L9ListMin)
+#define L9ListMax (l9ctx->L9ListMax)
+#define absdatablock (l9ctx->absdatablock)
+#define list2ptr (l9ctx->list2ptr)
+#define list3ptr (l9ctx->list3ptr)
+#define list9startptr (l9ctx->list9startptr)
+#define acodeptr (l9ctx->acodeptr)
+#define startmd (l9ctx->startmd)
+#define endmd (l9ctx->endmd)
+#define endwdp5 (l9ctx->endwdp5)
+#define wordtable (l9ctx->wordtable)
+#define dictdata (l9ctx->dictdata)
+#define defdict (l9ctx->defdict)
+#define dictdatalen (l9ctx->dictdatalen)
+#define startmdV2 (l9ctx->startmdV2)
+#define L9GameType (l9ctx->L9GameType)
+#define L9MsgType (l9ctx->L9MsgType)
+#define LastGame (l9ctx->LastGame)
+#define FirstLine (l9ctx->FirstLine)
+#define FirstLinePos (l9ctx->FirstLinePos)
+#define scanresult (l9ctx->scanresult)
+#define Rescan (l9ctx->Rescan)
+#define ScanCache (l9ctx->ScanCache)
+#define scanmemory (l9ctx->scanmemory)
+#define scanwindow (l9ctx->scanwindow)
+#define preloadlimit (l9ctx->preloadlimit)
+#define streamed (l9ctx->streamed)
+#define LoadStats (l9ctx->LoadStats)
+#define loadstats (l9ctx->loadstats)
+#define loadmemory (l9ctx->loadmemory)
+#define bootstart (l9ctx->bootstart)
+#define booting (l9ctx->booting)
+#ifdef L9PRELOAD
+#define preload (l9ctx->preload)
+#define preloads (l9ctx->preloads)
+#define preloading (l9ctx->preloading)
+#endif
+#define wordcase (l9ctx->wordcase)
+#define unpackcount (l9ctx->unpackcount)
+#define unpackbuf (l9ctx->unpackbuf)
+#define dictptr (l9ctx->dictptr)
+#define threechars (l9ctx->threechars)
+#define unpackd3 (l9ctx->unpackd3)
+#define mdtmode (l9ctx->mdtmode)
+#define msgindex (l9ctx->msgindex)
+#define msgindexed (l9ctx->msgindexed)
+#define subindex (l9ctx->subindex)
+#define subindexed (l9ctx->subindexed)
+#define lastactualchar (l9ctx->lastactualchar)
+#define d5 (l9ctx->d5)
+#define ramsavearea (l9ctx->ramsavearea)
+#define workspace (l9ctx->workspace)
+#define randomseed (l9ctx->randomseed)
+#define constseed (l9ctx->constseed)
+#define Running (l9ctx->Running)
+#define RunReason (l9ctx->RunReason)
+#define codeptr (l9ctx->codeptr)
+#define code (l9ctx->code)
+#define list9ptr (l9ctx->list9ptr)
+#define gnostack (l9ctx->gnostack)
+#define gnoscratch (l9ctx->gnoscratch)
+#define object (l9ctx->object)
+#define gnosp (l9ctx->gnosp)
+#define numobjectfound (l9ctx->numobjectfound)
+#define searchdepth (l9ctx->searchdepth)
+#define inithisearchpos (l9ctx->inithisearchpos)
+#define ibuff (l9ctx->ibuff)
+#define ibuffptr (l9ctx->ibuffptr)
+#define obuff (l9ctx->obuff)
+#define scriptfile (l9ctx->scriptfile)
+#define Cheating (l9ctx->Cheating)
+#define CheatWord (l9ctx->CheatWord)
+#define CheatWorkspace (l9ctx->CheatWorkspace)
+#define ResumableInput (l9ctx->ResumableInput)
+#define InputWait (l9ctx->InputWait)
+#define InputReady (l9ctx->InputReady)
+#define InputKey (l9ctx->InputKey)
+#define reflectflag (l9ctx->reflectflag)
+#define scale (l9ctx->scale)
+#define gintcolour (l9ctx->gintcolour)
+#define option (l9ctx->option)
+#define l9textmode (l9ctx->l9textmode)
+#define drawx (l9ctx->drawx)
+#define drawy (l9ctx->drawy)
+#define screencalled (l9ctx->screencalled)
+#define gfxa5 (l9ctx->gfxa5)
+#define bitmap (l9ctx->bitmap)
+#define gfx_mode (l9ctx->gfx_mode)
+#define GfxA5Stack (l9ctx->GfxA5Stack)
+#define GfxA5StackPos (l9ctx->GfxA5StackPos)
+#define GfxScaleStack (l9ctx->GfxScaleStack)
+#define GfxScaleStackPos (l9ctx->GfxScaleStackPos)
+#define irpool (l9ctx->irpool)
+#define irmap (l9ctx->irmap)
+#define irlegacyop (l9ctx->irlegacyop)
+#define irused (l9ctx->irused)
+#define irgen (l9ctx->irgen)
+#define irmapsize (l9ctx->irmapsize)
+#define irlow (l9ctx->irlow)
+#define irhigh (l9ctx->irhigh)
+#define irswitch (l9ctx->irswitch)
+#define irswitches (l9ctx->irswitches)
+#define FusedCount (l9ctx->FusedCount)
+#define aotlow (l9ctx->aotlow)
+#define aothigh (l9ctx->aothigh)
+#define aotvalid (l9ctx->aotvalid)
+#define Profiling (l9ctx->Profiling)
+#define ProfileKinds (l9ctx->ProfileKinds)
+#define ProfileCounts (l9ctx->ProfileCounts)
+#define ProfileSize (l9ctx->ProfileSize)
+#define Tracing (l9ctx->Tracing)
+#define tracefile (l9ctx->tracefile)
+#define tracebuf (l9ctx->tracebuf)
+#define traceblock (l9ctx->traceblock)
+#define tracepos (l9ctx->tracepos)
+#define traceserial (l9ctx->traceserial)
+#ifdef L9THREADS
+#define tracefull (l9ctx->tracefull)
+#define tracequit (l9ctx->tracequit)
+#define tracethread (l9ctx->tracethread)
+#define tracemutex (l9ctx->tracemutex)
+#define tracecond (l9ctx->tracecond)
+#endif
+
+/* notes a write to the game data at p, which lists can reach */
+#define MARKDIRTY(p) if (dirtymap && (p)>=startfile && (p)<startfile+startfilemap) \
+	IMAGEMARK(dirtymap,((p)-startfile)/DIRTYPAGE)
+#endif
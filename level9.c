@@ -32,6 +32,15 @@
 *  #picture <n>  show picture <n>
 *  #seed <n>     set the random number seed to the value <n>
 *  #play         plays back a file as the input to the game
+*  #trace <file> records the opcodes run to a trace file, which can
+*                be read with Tools/l9trace
+*  #trace off    stops recording the trace
+*  #profile      starts counting the opcodes run, or if already counting
+*                lists the busiest opcodes, addresses and subroutines
+*  #profile <file> writes the counts to a file, one per line
+*  #profile off  stops counting
+*  #fusion       lists how often each fused opcode form ran (FUSEDOPS
+*                builds only)
 *
 \***********************************************************************/
 
@@ -44,26 +53,84 @@
 #include <time.h>
 
 #include "level9.h"
+#define L9CONTEXT_NAMES
+#include "l9context.h"
+
+/* game files are mapped into memory rather than read, so that sessions of
+   the same game share the parts of it they have not written to */
+#if !defined(NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define L9MMAP
+#include <sys/mman.h>
+#ifndef MAP_ANON
+#define MAP_ANON MAP_ANONYMOUS
+#endif
+#define MAPSLACK 0x10000	/* zeros after the file, as lists may reach past it */
+#endif
+
+/* scan caches are written under a name of the process's own, and renamed */
+#if !defined(NO_SCAN_CACHE) && (defined(__unix__) || defined(__APPLE__))
+#define L9CACHEPID
+#include <unistd.h>
+#endif
+
+/* Scan() and ScanV2() split big files between this many threads at most */
+#define SCANTHREADS 16
+#define SCANPARTSIZE 0x10000	/* the least worth giving a thread */
+#ifdef L9THREADS
+#include <unistd.h>
+#endif
+
+/* and pick out the offsets worth looking at with SIMD instructions, 16 or
+   32 at a time, in blocks of this many */
+#define SCANBLOCK 4096
+#if !defined(NO_SIMD) && defined(__AVX2__)
+#define SCANAVX2
+#include <immintrin.h>
+#elif !defined(NO_SIMD) && defined(__SSE2__)
+#define SCANSSE2
+#include <emmintrin.h>
+#elif !defined(NO_SIMD) && defined(__ARM_NEON)
+#define SCANNEON
+#include <arm_neon.h>
+#endif
+
+/* the scans keep a byte sum of the file up to every CHKBLOCK bytes, as
+   well as the map of walked code in l9context.h */
+#define CHKBLOCK 64
+
+/* files bigger than the scan window are scanned a window at a time, the
+   windows overlapping by this much, the most that the offsets in a V2, V3
+   or V4 game can reach from its header; that much is all that is read */
+#define SCANSPAN 0x10000
 
 /* #define L9DEBUG */
-/* #define CODEFOLLOW */
 /* #define FULLSCAN */
+/* #define THREADEDCODE */
+/* #define PREDECODE */
+/* #define FUSEDOPS */
+/* #define AOTCODE */
+
+/* games translated by Tools/l9aot fall back to the plain interpreter,
+   which keeps track of writes into the translated code */
+#ifdef AOTCODE
+#undef THREADEDCODE
+#endif
+/* threaded code needs the GCC/Clang labels as values extension */
+#if defined(THREADEDCODE) && (!defined(__GNUC__) || defined(L9DEBUG))
+#undef THREADEDCODE
+#endif
+/* the decoded instruction cache is built on the threaded code */
+#if defined(PREDECODE) && !defined(THREADEDCODE)
+#undef PREDECODE
+#endif
+/* opcode fusion works on the decoded cache */
+#if defined(FUSEDOPS) && !defined(PREDECODE)
+#undef FUSEDOPS
+#endif
 
 /* "L901" */
 #define L9_ID 0x4c393031
 
-#define IBUFFSIZE 500
-#define RAMSAVESLOTS 10
-#define GFXSTACKSIZE 100
-#define FIRSTLINESIZE 96
-
-/* Typedefs */
-typedef struct
-{
-	L9UINT16 vartable[256];
-	L9BYTE listarea[LISTAREASIZE];
-} SaveStruct;
-
 /* Enumerations */
 enum L9GameTypes { L9_V1, L9_V2, L9_V3, L9_V4 };
 enum L9MsgTypes { MSGT_V1, MSGT_V2 };
@@ -77,93 +144,824 @@ enum L9MsgTypes { MSGT_V1, MSGT_V2 };
 */
 enum L9GfxTypes { GFX_V2, GFX_V3A, GFX_V3B, GFX_V3C };
 
-/* Global Variables */
-L9BYTE* startfile=NULL,*pictureaddress=NULL,*picturedata=NULL;
-L9BYTE* startdata;
-L9UINT32 FileSize,picturesize;
-
-L9BYTE *L9Pointers[12];
-L9BYTE *absdatablock,*list2ptr,*list3ptr,*list9startptr,*acodeptr;
-L9BYTE *startmd,*endmd,*endwdp5,*wordtable,*dictdata,*defdict;
-L9UINT16 dictdatalen;
-L9BYTE *startmdV2;
-
-int wordcase;
-int unpackcount;
-char unpackbuf[8];
-L9BYTE* dictptr;
-char threechars[34];
-int L9GameType;
-int L9MsgType;
-char LastGame[MAX_PATH];
-char FirstLine[FIRSTLINESIZE];
-int FirstLinePos=0;
-int FirstPicture=-1;
-
+/* Global Variables, besides those of each game in l9context.h */
 #if defined(AMIGA) && defined(_DCC)
-__far SaveStruct ramsavearea[RAMSAVESLOTS];
-#else
-SaveStruct ramsavearea[RAMSAVESLOTS];
+__far
 #endif
+L9Context l9default;	/* see defaultcontext() */
+L9BOOL l9defaultready=FALSE;
+L9LOCAL L9Context* l9ctx=&l9default;
+
+#ifdef PREDECODE
+typedef struct L9Op
+{
+	void* handler;		/* label in executepredecoded */
+	L9BYTE* pc;		/* A-code address of the opcode */
+	L9BYTE* next;		/* A-code address after the operands */
+	L9BYTE* dest;		/* A-code branch target */
+	struct L9Op* target;	/* decoded branch target, once known */
+	L9UINT16 a,b,c;		/* variable numbers, list offset or number, constant */
+	L9BYTE kind;
+} L9Op;
+#endif
+
+#ifdef AOTCODE
+/* supplied by the C file that Tools/l9aot writes for one game */
+extern const L9UINT32 l9aot_filesize,l9aot_acode,l9aot_low,l9aot_high;
+extern const L9BYTE l9aot_code[],l9aot_entries[];
+void l9aot_run(L9UINT32* n);
+/* whether the translated code can be entered at p */
+#define aotentry(p) ((p)>=aotlow && (p)<aothigh && IMAGETEST(l9aot_entries,(p)-aotlow))
+#endif
+
+L9BYTE exitreversaltable[20]= {0x00,0x04,0x06,0x07,0x01,0x08,0x02,0x03,0x05,0x0a,0x09,0x0c,0x0b,0xff,0xff,0x0f,0xff,0xff,0xff,0xff};
+
+struct L9V1GameInfo
+{
+	L9BYTE dictVal1, dictVal2;
+	int dictStart, L9Ptrs[5], absData, msgStart, msgLen;
+};
+struct L9V1GameInfo L9V1Games[] =
+{
+	0x1a,0x24,301, 0x0000,-0x004b, 0x0080,-0x002b, 0x00d0,0x03b0, 0x0f80,0x4857, /* Colossal Adventure */
+	0x20,0x3b,283,-0x0583, 0x0000,-0x0508,-0x04e0, 0x0000,0x0800, 0x1000,0x39d1, /* Adventure Quest */
+	0x14,0xff,153,-0x00d6, 0x0000, 0x0000, 0x0000, 0x0000,0x0a20, 0x16bf,0x420d, /* Dungeon Adventure */
+	0x15,0x5d,252,-0x3e70, 0x0000,-0x3d30,-0x3ca0, 0x0100,0x4120,-0x3b9d,0x3988, /* Lords of Time */
+	0x15,0x6c,284,-0x00f0, 0x0000,-0x0050,-0x0050,-0x0050,0x0300, 0x1930,0x3c17, /* Snowball */
+};
+
+/* Known games, from L9cut's l9data_d.h (version 050, 22 Oct 2002), found
+   by the length, checksum and CRC of their data. See findknowngame(). */
+struct L9KnownGame
+{
+	L9UINT16 length;	/* of the data, less one */
+	L9BYTE checksum;	/* the last byte of the data, or for V2 games the sum of it */
+	L9UINT16 crc;		/* as L9cut works it out, see calccrc() */
+	const char* name;
+};
+struct L9KnownGame L9KnownGames[] =
+{
+	{0x5323, 0xb7, 0x8af7, "Adventure Quest (Amstrad CPC/Spectrum)"},
+
+	{0x630e, 0x8d, 0x7d7d, "Dungeon Adventure (Amstrad CPC)"},
+	{0x630e, 0xbe, 0x3374, "Dungeon Adventure (MSX)"},
+
+	{0x5eb9, 0x30, 0xe99a, "Lords of Time (Amstrad CPC)"},
+	{0x5eb9, 0x5d, 0xc098, "Lords of Time (MSX)"},
+	{0x5eb9, 0x6e, 0xc689, "Lords of Time (Spectrum)"},
+
+	{0x5fab, 0x5c, 0xa309, "Snowball (Amstrad CPC)"},
+	{0x5fab, 0x2f, 0x8aa2, "Snowball (MSX)"},
+
+	{0x60c4, 0x28, 0x0154, "Return to Eden (Amstrad CPC/Commodore 64[v1])"},
+	{0x6064, 0x01, 0x5b3c, "Return to Eden (BBC[v1])"},
+	{0x6064, 0x95, 0x510c, "Return to Eden (Commodore 64[v2])"},
+	{0x6064, 0xda, 0xe610, "Return to Eden (Commodore 64[v2] *corrupt*)"},
+	{0x6064, 0xbd, 0x73ec, "Return to Eden (Atari *corrupt*)"},
+	{0x6047, 0x6c, 0x17ab, "Return to Eden (BBC[v2])"},
+	{0x5ca1, 0x33, 0x1c43, "Return to Eden (Spectrum[v1])"},
+	{0x5cb7, 0x64, 0x0790, "Return to Eden (Spectrum[v2])"},
+	{0x5cb7, 0xfe, 0x3533, "Return to Eden (MSX)"},
+
+	{0x34b3, 0x20, 0xccda, "Erik the Viking (BBC/Commodore 64)"},
+	{0x34b3, 0x53, 0x8f00, "Erik the Viking (Spectrum)"},
+	{0x34b3, 0xc7, 0x9058, "Erik the Viking (Amstrad CPC)"},
+
+	{0x63be, 0xd6, 0xcf5d,
+		"Emerald Isle (Atari/Commodore 64/Amstrad CPC/Spectrum)"},
+	{0x63be, 0x0a, 0x21ed, "Emerald Isle (MSX *corrupt*)"},
+	{0x378c, 0x8d, 0x3a21, "Emerald Isle (BBC)"},
+
+	{0x506c, 0xf0, 0xba72, "Red Moon (BBC/Commodore 64/Amstrad CPC/MSX)"},
+	{0x505d, 0x32, 0x2dcf, "Red Moon (Spectrum)"},
+
+	{0x772b, 0xcd, 0xa503, "Worm in Paradise (Spectrum 128)"},
+	{0x546c, 0xb7, 0x9420, "Worm in Paradise (Spectrum 48)"},
+	{0x6d84, 0xf9, 0x49ae, "Worm in Paradise (Commodore 64 *corrupt*)"},
+	{0x6d84, 0xc8, 0x943f, "Worm in Paradise (Commodore 64 *fixed*)"},
+	{0x6030, 0x47, 0x46ad, "Worm in Paradise (Amstrad CPC)"},
+	{0x5828, 0xbd, 0xe7cb, "Worm in Paradise (BBC)"},
+
+	{0x7410, 0x5e, 0x60be, "Price of Magik (Spectrum 128)"},
+	{0x5aa4, 0xc1, 0x10a0, "Price of Magik (Spectrum 48[v1])"},
+	{0x5aa4, 0xc1, 0xeda4, "Price of Magik (Spectrum 48[v2])"},
+	{0x6fc6, 0x14, 0xf9b6, "Price of Magik (Commodore 64)"},
+	{0x5aa4, 0xc1, 0xbbf4, "Price of Magik (Amstrad CPC)"},
+	{0x5671, 0xbc, 0xff35, "Price of Magik (BBC)"},
+
+	{0x76f4, 0x5e, 0x1fe5, "Colossal Adventure /JoD (Amiga/PC)"},
+	{0x76f4, 0x5a, 0xcf4b, "Colossal Adventure /JoD (ST)"},
+	{0x6e60, 0x83, 0x18e0, "Adventure Quest /JoD (Amiga/PC)"},
+	{0x6e5c, 0xf6, 0xd356, "Adventure Quest /JoD (ST)"},
+	{0x6f0c, 0x95, 0x1f64, "Dungeon Adventure /JoD (Amiga/PC/ST)"},
+
+	{0x6f70, 0x40, 0xbd91, "Colossal Adventure /JoD (MSX)"},
+
+	{0x6f6e, 0x78, 0x28cd, "Colossal Adventure /JoD (Spectrum 128)"},
+	{0x6970, 0xd6, 0xa820, "Adventure Quest /JoD (Spectrum 128)"},
+	{0x6de8, 0x4c, 0xd795, "Dungeon Adventure /JoD (Spectrum 128)"},
+
+	{0x6f4d, 0xcb, 0xe8f2,
+		"Colossal Adventure /JoD (Amstrad CPC128[v1]/Spectrum +3)"},
+	{0x6f6a, 0xa5, 0x8dd2, "Colossal Adventure /JoD (Amstrad CPC128[v2])"},
+	{0x6968, 0x32, 0x0c01, "Adventure Quest /JoD (Amstrad CPC128/Spectrum +3)"},
+	{0x6dc0, 0x63, 0x5d95, "Dungeon Adventure /JoD (Amstrad CPC128/Spectrum +3)"},
+
+	{0x5e31, 0x7c, 0xaa54, "Colossal Adventure /JoD (Amstrad CPC64)"},
+	{0x5b50, 0x66, 0x1800, "Adventure Quest /JoD (Amstrad CPC64)"},
+	{0x58a6, 0x24, 0xb50f, "Dungeon Adventure /JoD (Amstrad CPC64)"},
+
+	{0x6c8e, 0xb6, 0x9be3, "Colossal Adventure /JoD (Commodore 64)"},
+	{0x63b6, 0x2e, 0xef38, "Adventure Quest /JoD (Commodore 64)"},
+	{0x6bd2, 0x65, 0xa41f, "Dungeon Adventure /JoD (Commodore 64)"},
+
+	{0x5b16, 0x3b, 0xe2aa, "Colossal Adventure /JoD (Atari)"},
+	{0x5b58, 0x50, 0x332e, "Adventure Quest /JoD (Atari)"},
+	{0x593a, 0x80, 0x7a34, "Dungeon Adventure /JoD (Atari)"},
+
+	{0x5a8e, 0xf2, 0x7cca, "Colossal Adventure /JoD (Spectrum 48)"},
+	{0x5ace, 0x11, 0xdc12, "Adventure Quest /JoD (Spectrum 48)"},
+	{0x58a3, 0x38, 0x8ce4, "Dungeon Adventure /JoD (Spectrum 48)"},
+
+	{0x7b31, 0x6e, 0x2e2b, "Snowball /SD (Amiga/ST)"},
+	{0x7d16, 0xe6, 0x5438, "Return to Eden /SD (Amiga/ST)"},
+	{0x7cd9, 0x0c, 0x4df1, "Worm in Paradise /SD (Amiga/ST)"},
+
+	{0x7b2f, 0x70, 0x6955, "Snowball /SD (Mac/PC/Spectrum 128)"},
+	{0x7b2f, 0x70, 0x6f6c, "Snowball /SD (Amstrad CPC/Spectrum +3)"},
+	{0x7d14, 0xe8, 0xfbab, "Return to Eden /SD (PC)"},
+	{0x7cff, 0xf8, 0x6044, "Return to Eden /SD (Amstrad CPC/Spectrum +3)"},
+	{0x7cf8, 0x24, 0x9c1c, "Return to Eden /SD (Mac)"},
+	{0x7c55, 0x18, 0xdaee, "Return to Eden /SD (Spectrum 128)"},
+	{0x7cd7, 0x0e, 0x4feb,
+		"Worm in Paradise /SD (Amstrad CPC/Mac/PC/Spectrum 128/Spectrum +3)"},
+
+	{0x7363, 0x65, 0xa0ab, "Snowball /SD (Commodore 64)"},
+	{0x772f, 0xca, 0x8602, "Return to Eden /SD (Commodore 64)"},
+	{0x788d, 0x72, 0x888a, "Worm in Paradise /SD (Commodore 64)"},
+
+	{0x6bf8, 0x3f, 0xc9f7, "Snowball /SD (Atari)"},
+	{0x60f7, 0x68, 0xc2bc, "Return to Eden /SD (Atari)"},
+	{0x6161, 0xf3, 0xe6d7, "Worm in Paradise /SD (Atari)"},
+
+	{0x67a3, 0x9d, 0x1d05, "Snowball /SD (Apple ][)"},
+	{0x639c, 0x8b, 0x06e2, "Return to Eden /SD (Apple ][)"},
+	{0x60dd, 0xf2, 0x5bb8, "Worm in Paradise /SD (Apple ][)"},
+
+	{0x6541, 0x02, 0x2e6c, "Snowball /SD (Spectrum 48)"},
+	{0x5f43, 0xca, 0x828c, "Return to Eden /SD (Spectrum 48)"},
+	{0x5ebb, 0xf1, 0x4dec, "Worm in Paradise /SD (Spectrum 48)"},
+
+	{0x8333, 0xb7, 0xe2ac, "Adrian Mole I, pt. 1 (Commodore 64)"},
+	{0x844d, 0x50, 0x5353, "Adrian Mole I, pt. 2 (Commodore 64)"},
+	{0x8251, 0x5f, 0x862a, "Adrian Mole I, pt. 3 (Commodore 64)"},
+	{0x7a78, 0x5e, 0x6ea3, "Adrian Mole I, pt. 4 (Commodore 64)"},
+
+	{0x7c6f, 0x0f, 0xba24, "Adrian Mole I, pt. 1 (Amstrad CPC)"},
+
+	{0x72fa, 0x8b, 0x6f12, "Adrian Mole I, pt. 1 (Spectrum)"},
+	{0x738e, 0x5b, 0x7e3d, "Adrian Mole I, pt. 2 (Spectrum)"},
+	{0x7375, 0xe5, 0x3f3e, "Adrian Mole I, pt. 3 (Spectrum)"},
+	{0x78d5, 0xe3, 0xcd7d, "Adrian Mole I, pt. 4 (Spectrum)"},
+
+	{0x3a31, 0xe5, 0x0bdb, "Adrian Mole I, pt. 1 (BBC)"},
+	{0x37f1, 0x77, 0xd231, "Adrian Mole I, pt. 2 (BBC)"},
+	{0x3900, 0x1c, 0x5d9a, "Adrian Mole I, pt. 3 (BBC)"},
+	{0x3910, 0xac, 0x07f9, "Adrian Mole I, pt. 4 (BBC)"},
+	{0x3ad6, 0xa7, 0x95d2, "Adrian Mole I, pt. 5 (BBC)"},
+	{0x38a5, 0x0f, 0xdefc, "Adrian Mole I, pt. 6 (BBC)"},
+	{0x361e, 0x7e, 0xfd9f, "Adrian Mole I, pt. 7 (BBC)"},
+	{0x3934, 0x75, 0xe141, "Adrian Mole I, pt. 8 (BBC)"},
+	{0x3511, 0xcc, 0xd829, "Adrian Mole I, pt. 9 (BBC)"},
+	{0x38dd, 0x31, 0x2534, "Adrian Mole I, pt. 10 (BBC)"},
+	{0x39c0, 0x44, 0x89df, "Adrian Mole I, pt. 11 (BBC)"},
+	{0x3a12, 0x8f, 0xc2bd, "Adrian Mole I, pt. 12 (BBC)"},
+
+	{0x7931, 0xb9, 0xc51b, "Adrian Mole II, pt. 1 (Commodore 64/Amstrad CPC)"},
+	{0x7cdf, 0xa5, 0x43e3, "Adrian Mole II, pt. 2 (Commodore 64/Amstrad CPC)"},
+	{0x7a0c, 0x97, 0x4bea, "Adrian Mole II, pt. 3 (Commodore 64/Amstrad CPC)"},
+	{0x7883, 0xe2, 0xee0e, "Adrian Mole II, pt. 4 (Commodore 64/Amstrad CPC)"},
+
+	{0x6841, 0x4a, 0x94e7, "Adrian Mole II, pt. 1 (Spectrum)"},
+	{0x6bc0, 0x62, 0xab3d, "Adrian Mole II, pt. 2 (Spectrum)"},
+	{0x692c, 0x21, 0x2015, "Adrian Mole II, pt. 3 (Spectrum)"},
+	{0x670a, 0x94, 0xa2a6, "Adrian Mole II, pt. 4 (Spectrum)"},
+
+	{0x593a, 0xaf, 0x30e9, "Adrian Mole II, pt. 1 (BBC)"},
+	{0x57e6, 0x8a, 0xc41a, "Adrian Mole II, pt. 2 (BBC)"},
+	{0x5819, 0xcd, 0x1ba0, "Adrian Mole II, pt. 3 (BBC)"},
+	{0x579b, 0xad, 0xa723, "Adrian Mole II, pt. 4 (BBC)"},
+
+	{0x765d, 0xcd, 0xfc02, "The Archers, pt. 1 (Commodore 64)"},
+	{0x6e58, 0x07, 0xbffc, "The Archers, pt. 2 (Commodore 64)"},
+	{0x7e98, 0x6a, 0x95e5, "The Archers, pt. 3 (Commodore 64)"},
+	{0x81e2, 0xd5, 0xb278, "The Archers, pt. 4 (Commodore 64)"},
+
+	{0x6ce5, 0x58, 0x46de, "The Archers, pt. 1 (Spectrum)"},
+	{0x68da, 0xc1, 0x3b8e, "The Archers, pt. 2 (Spectrum)"},
+	{0x6c67, 0x9a, 0x9a6a, "The Archers, pt. 3 (Spectrum)"},
+	{0x6d91, 0xb9, 0x12a7, "The Archers, pt. 4 (Spectrum)"},
+
+	{0x5834, 0x42, 0xcc9d, "The Archers, pt. 1 (BBC)"},
+	{0x56dd, 0x51, 0xe582, "The Archers, pt. 2 (BBC)"},
+	{0x5801, 0x53, 0xf2ef, "The Archers, pt. 3 (BBC)"},
+	{0x54a4, 0x01, 0xc0ab, "The Archers, pt. 4 (BBC)"},
+
+	{0x579e, 0x97, 0x9faa, "Lords of Time /T&M GD (BBC)"},
+	{0x5500, 0x50, 0xca75, "Red Moon /T&M GD (BBC)"},
+	{0x579a, 0x2a, 0x9373, "Price of Magik /T&M GD (BBC)"},
+
+	{0x4fd2, 0x9d, 0x799a, "Lancelot, pt. 1 GD (BBC)"},
+	{0x4dac, 0xa8, 0x86ed, "Lancelot, pt. 2 GD (BBC)"},
+	{0x4f96, 0x22, 0x30f8, "Lancelot, pt. 3 GD (BBC)"},
+
+	{0x55ce, 0xa1, 0xba12, "Scapeghost, pt. 1 GD (BBC)"},
+	{0x54a6, 0xa9, 0xc9f3, "Scapeghost, pt. 2 GD (BBC)"},
+	{0x51bc, 0xe3, 0x89c3, "Scapeghost, pt. 3 GD (BBC)"},
+
+	{0x46ec, 0x64, 0x2300, "Knight Orc, pt. 1 GD (Amstrad CPC/Spectrum +3)"},
+	{0x6140, 0x18, 0x4f66, "Knight Orc, pt. 2 GD (Amstrad CPC/Spectrum +3)"},
+	{0x640e, 0xc1, 0xfc69, "Knight Orc, pt. 3 GD (Amstrad CPC/Spectrum +3)"},
+
+	{0x5ff0, 0xf8, 0x3a13, "Gnome Ranger, pt. 1 GD (Amstrad CPC/Spectrum +3)"},
+	{0x6024, 0x01, 0xaaa9, "Gnome Ranger, pt. 2 GD (Amstrad CPC/Spectrum +3)"},
+	{0x6036, 0x3d, 0x6c6c, "Gnome Ranger, pt. 3 GD (Amstrad CPC/Spectrum +3)"},
+
+	{0x69fe, 0x56, 0xecfb, "Lords of Time /T&M GD (Amstrad CPC/Spectrum +3)"},
+	{0x6888, 0x8d, 0x7f6a, "Red Moon /T&M GD (Amstrad CPC/Spectrum +3)"},
+	{0x5a50, 0xa9, 0xa5fa, "Price of Magik /T&M GD (Amstrad CPC/Spectrum +3)"},
+
+	{0x5c7a, 0x44, 0x460e, "Lancelot, pt. 1 GD (Amstrad CPC/Spectrum +3)"},
+	{0x53a2, 0x1e, 0x2fae, "Lancelot, pt. 2 GD (Amstrad CPC/Spectrum +3)"},
+	{0x5914, 0x22, 0x4a31, "Lancelot, pt. 3 GD (Amstrad CPC/Spectrum +3)"},
+
+	{0x5a38, 0xf7, 0x876e, "Ingrid's Back, pt. 1 GD (Amstrad CPC/Spectrum +3)"},
+	{0x531a, 0xed, 0xcf3f, "Ingrid's Back, pt. 2 GD (Amstrad CPC/Spectrum +3)"},
+	{0x57e4, 0x19, 0xb354, "Ingrid's Back, pt. 3 GD (Amstrad CPC/Spectrum +3)"},
+
+	{0x5cbc, 0xa5, 0x0dbe, "Scapeghost, pt. 1 GD (Amstrad CPC/Spectrum +3)"},
+	{0x5932, 0x4e, 0xb2f5, "Scapeghost, pt. 2 GD (Amstrad CPC/Spectrum +3)"},
+	{0x5860, 0x95, 0x3227, "Scapeghost, pt. 3 GD (Amstrad CPC/Spectrum +3)"},
+
+	{0x74e0, 0x92, 0x885e, "Knight Orc, pt. 1 GD (Spectrum 128)"},
+	{0x6dbc, 0x97, 0x6f55, "Knight Orc, pt. 2 GD (Spectrum 128)"},
+	{0x7402, 0x07, 0x385f, "Knight Orc, pt. 3 GD (Spectrum 128)"},
+
+	{0x52aa, 0xdf, 0x7b5b, "Gnome Ranger, pt. 1 GD (Spectrum 128)"},
+	{0x6ffa, 0xdb, 0xdde2, "Gnome Ranger, pt. 2 GD (Spectrum 128)"},
+	{0x723a, 0x69, 0x039b, "Gnome Ranger, pt. 3 GD (Spectrum 128)"},
+
+	{0x6f1e, 0xda, 0x2ce0, "Lords of Time /T&M GD (Spectrum 128)"},
+	{0x6da0, 0xb8, 0x3802, "Red Moon /T&M GD (Spectrum 128)"},
+	{0x6108, 0xdd, 0xefe7, "Price of Magik /T&M GD (Spectrum 128)"},
+
+	{0x768c, 0xe8, 0x8fc6, "Lancelot, pt. 1 GD (Spectrum 128)"},
+	{0x76b0, 0x1d, 0x0fcd, "Lancelot, pt. 2 GD (Spectrum 128)"},
+	{0x765e, 0x4f, 0x3b73, "Lancelot, pt. 3 GD (Spectrum 128)"},
+
+	{0x76a0, 0x3a, 0xb803, "Ingrid's Back, pt. 1 GD (Spectrum 128)"},
+	{0x7674, 0x0b, 0xe92f, "Ingrid's Back, pt. 2 GD (Spectrum 128)"},
+	{0x765e, 0xba, 0x086d, "Ingrid's Back, pt. 3 GD (Spectrum 128)"},
+
+	{0x762e, 0x82, 0x8848, "Scapeghost, pt. 1 GD (Spectrum 128)"},
+	{0x5bd6, 0x35, 0x79ef, "Scapeghost, pt. 2 GD (Spectrum 128)"},
+	{0x6fa8, 0xa4, 0x62c2, "Scapeghost, pt. 3 GD (Spectrum 128)"},
+
+	{0xbb93, 0x36, 0x6a05, "Knight Orc, pt. 1 (Amiga)"},
+	{0xbb6e, 0xad, 0x4d40, "Knight Orc, pt. 1 (ST)"},
+	{0xc58e, 0x4a, 0x4e9d, "Knight Orc, pt. 2 (Amiga/ST)"},
+	{0xcb9a, 0x0f, 0x0804, "Knight Orc, pt. 3 (Amiga/ST)"},
+
+	{0xbb6e, 0xa6, 0x9753, "Knight Orc, pt. 1 (PC)"},
+	{0xc58e, 0x43, 0xe9ce, "Knight Orc, pt. 2 (PC)"},
+	{0xcb9a, 0x08, 0x6c36, "Knight Orc, pt. 3 (PC)"},
+
+	{0x898a, 0x43, 0xfc8b, "Knight Orc, pt. 1 (Apple ][)"},
+	{0x8b9f, 0x61, 0x7288, "Knight Orc, pt. 2 (Apple ][)"},
+	{0x8af9, 0x61, 0x7542, "Knight Orc, pt. 3 (Apple ][)"},
+
+	{0x8970, 0x6b, 0x3c7b, "Knight Orc, pt. 1 (Commodore 64 Gfx)"},
+	{0x8b90, 0x4e, 0x098c, "Knight Orc, pt. 2 (Commodore 64 Gfx)"},
+	{0x8aea, 0x4e, 0xca54, "Knight Orc, pt. 3 (Commodore 64 Gfx)"},
+
+	{0x86d0, 0xb7, 0xadbd, "Knight Orc, pt. 1 (Spectrum 48)"},
+	{0x8885, 0x22, 0xe293, "Knight Orc, pt. 2 (Spectrum 48)"},
+	{0x87e5, 0x0e, 0xdc33, "Knight Orc, pt. 3 (Spectrum 48)"},
+
+	{0xb1a9, 0x80, 0x5fb7, "Gnome Ranger, pt. 1 (Amiga/ST)"},
+	{0xab9d, 0x31, 0xbe6d, "Gnome Ranger, pt. 2 (Amiga/ST)"},
+	{0xae28, 0x87, 0xb6b6, "Gnome Ranger, pt. 3 (Amiga/ST)"},
 
-GameState workspace;
+	{0xb0ec, 0xc2, 0x0053, "Gnome Ranger, pt. 1 (ST[v1])"},
+	{0xaf82, 0x83, 0x19f7, "Gnome Ranger, pt. 2 (ST[v1])"},
+
+	{0xb1aa, 0xad, 0xaf47, "Gnome Ranger, pt. 1 (PC)"},
+	{0xb19e, 0x92, 0x8f96, "Gnome Ranger, pt. 1 (ST[v2])"},
+	{0xab8b, 0xbf, 0x31e6, "Gnome Ranger, pt. 2 (PC/ST[v2])"},
+	{0xae16, 0x81, 0x8741, "Gnome Ranger, pt. 3 (PC/ST[v2])"},
 
-L9UINT16 randomseed;
-L9UINT16 constseed=0;
-L9BOOL Running;
+	{0xad41, 0xa8, 0x42c5, "Gnome Ranger, pt. 1 (Commodore 64 TO)"},
+	{0xa735, 0xf7, 0x2e08, "Gnome Ranger, pt. 2 (Commodore 64 TO)"},
+	{0xa9c0, 0x9e, 0x0d70, "Gnome Ranger, pt. 3 (Commodore 64 TO)"},
 
-char ibuff[IBUFFSIZE];
-L9BYTE* ibuffptr;
-char obuff[34];
-FILE* scriptfile=NULL;
+	{0x908e, 0x0d, 0x58a7, "Gnome Ranger, pt. 1 (Commodore 64 Gfx)"},
+	{0x8f6f, 0x0a, 0x411a, "Gnome Ranger, pt. 2 (Commodore 64 Gfx)"},
+	{0x9060, 0xbb, 0xe75d, "Gnome Ranger, pt. 3 (Commodore 64 Gfx)"},
+
+	{0x8aab, 0xc0, 0xde5f, "Gnome Ranger, pt. 1 (Spectrum 48)"},
+	{0x8ac8, 0x9a, 0xc89b, "Gnome Ranger, pt. 2 (Spectrum 48)"},
+	{0x8a93, 0x4f, 0x10cc, "Gnome Ranger, pt. 3 (Spectrum 48)"},
+
+	{0xb57c, 0x44, 0x7779, "Lords of Time /T&M (PC)"},
+	{0xa69e, 0x6c, 0xb268, "Red Moon /T&M (PC)"},
+	{0xbac7, 0x7f, 0xddb2, "Price of Magik /T&M (PC)"},
+
+	{0xb579, 0x89, 0x3e89, "Lords of Time /T&M (ST)"},
+	{0xa698, 0x41, 0xcaca, "Red Moon /T&M (ST)"},
+	{0xbac4, 0x80, 0xa750, "Price of Magik /T&M (ST)"},
+
+	{0xb576, 0x2a, 0x7239, "Lords of Time /T&M (Amiga)"},
+	{0xa692, 0xd1, 0x6a99, "Red Moon /T&M (Amiga)"},
+	{0xbaca, 0x3a, 0x221b, "Price of Magik /T&M (Amiga)"},
 
-L9BOOL Cheating=FALSE;
-int CheatWord;
-GameState CheatWorkspace;
+	{0xb563, 0x6a, 0x0c5c, "Lords of Time /T&M (Mac)"},
+	{0xa67c, 0xb8, 0xff41, "Red Moon /T&M (Mac)"},
+	{0xbab2, 0x87, 0x09f5, "Price of Magik /T&M (Mac)"},
 
-int reflectflag,scale,gintcolour,option;
-int l9textmode=0,drawx=0,drawy=0,screencalled=0,showtitle=1;
-L9BYTE *gfxa5=NULL;
-Bitmap* bitmap=NULL;
-int gfx_mode=GFX_V2;
+	{0xb38c, 0x37, 0x9f8e, "Lords of Time /T&M (Commodore 64 TO)"},
+	{0xa4e2, 0xa6, 0x016d, "Red Moon /T&M (Commodore 64 TO)"},
+	{0xb451, 0xa8, 0x2682, "Price of Magik /T&M (Commodore 64 TO)"},
 
-L9BYTE* GfxA5Stack[GFXSTACKSIZE];
-int GfxA5StackPos=0;
-int GfxScaleStack[GFXSTACKSIZE];
-int GfxScaleStackPos=0;
+	{0x9070, 0x43, 0x45d4, "Lords of Time /T&M (Commodore 64 Gfx)"},
+	{0x903f, 0x6b, 0x603e, "Red Moon /T&M (Commodore 64 Gfx)"},
+	{0x8f51, 0xb2, 0x6c9a, "Price of Magik /T&M (Commodore 64 Gfx)"},
 
-char lastchar='.';
-char lastactualchar=0;
-int d5;
+	{0x8950, 0xa1, 0xbb16, "Lords of Time /T&M (Spectrum 48)"},
+	{0x8813, 0x11, 0x22de, "Red Moon /T&M (Spectrum 48)"},
+	{0x8a60, 0x2a, 0x29ed, "Price of Magik /T&M (Spectrum 48)"},
 
-L9BYTE* codeptr; /* instruction codes */
-L9BYTE code;
+	{0xb260, 0xe5, 0xc5b2, "Lords of Time /T&M (PC/ST *USA*)"},
+	{0xa3a4, 0xdf, 0x6732, "Red Moon /T&M (PC/ST *USA*)"},
+	{0xb7a0, 0x7e, 0x2226, "Price of Magik /T&M (PC/ST *USA*)"},
 
-L9BYTE* list9ptr;
+	{0xb257, 0xf8, 0xfbd5, "Lords of Time /T&M (Amiga *USA*)"},
+	{0xa398, 0x82, 0xd031, "Red Moon /T&M (Amiga *USA*)"},
+	{0xb797, 0x1f, 0x84a9, "Price of Magik /T&M (Amiga *USA*)"},
 
-int unpackd3;
+	{0x8d78, 0x3a, 0xba6e, "Lords of Time /T&M (Commodore 64 Gfx *USA*)"},
+	{0x8d56, 0xd3, 0x146a, "Red Moon /T&M (Commodore 64 Gfx *USA*)"},
+	{0x8c46, 0xf0, 0xcaf6, "Price of Magik /T&M (Commodore 64 Gfx *USA*)"},
 
-L9BYTE exitreversaltable[20]= {0x00,0x04,0x06,0x07,0x01,0x08,0x02,0x03,0x05,0x0a,0x09,0x0c,0x0b,0xff,0xff,0x0f,0xff,0xff,0xff,0xff};
+	{0xc0cf, 0x4e, 0xb7fa, "Lancelot, pt. 1 (Amiga/PC/ST)"},
+	{0xd5e9, 0x6a, 0x4192, "Lancelot, pt. 2 (Amiga/PC/ST)"},
+	{0xbb8f, 0x1a, 0x7487, "Lancelot, pt. 3 (Amiga/PC/ST)"},
 
-L9UINT16 gnostack[128];
-L9BYTE gnoscratch[32];
-int object,gnosp,numobjectfound,searchdepth,inithisearchpos;
+	{0xc0bd, 0x57, 0x6ef1, "Lancelot, pt. 1 (Mac)"},
+	{0xd5d7, 0x99, 0x770b, "Lancelot, pt. 2 (Mac)"},
+	{0xbb7d, 0x17, 0xbc42, "Lancelot, pt. 3 (Mac)"},
 
+	{0xb4c9, 0x94, 0xd784, "Lancelot, pt. 1 (Commodore 64 TO)"},
+	{0xb729, 0x51, 0x8ee5, "Lancelot, pt. 2 (Commodore 64 TO)"},
+	{0xb702, 0xe4, 0x1809, "Lancelot, pt. 3 (Commodore 64 TO)"},
 
-struct L9V1GameInfo
+	{0x8feb, 0xba, 0xa800, "Lancelot, pt. 1 (Commodore 64 Gfx)"},
+	{0x8f6b, 0xfa, 0x0f7e, "Lancelot, pt. 2 (Commodore 64 Gfx)"},
+	{0x8f71, 0x2f, 0x0ddc, "Lancelot, pt. 3 (Commodore 64 Gfx)"},
+
+	{0x8ade, 0xf2, 0xfffb, "Lancelot, pt. 1 (Spectrum 48)"},
+	{0x8b0e, 0xfb, 0x0bab, "Lancelot, pt. 2 (Spectrum 48)"},
+	{0x8ab3, 0xc1, 0xcb62, "Lancelot, pt. 3 (Spectrum 48)"},
+
+	{0xbba4, 0x94, 0x0871, "Lancelot, pt. 1 (Amiga/PC *USA*)"},
+	{0xd0c0, 0x56, 0x8c48, "Lancelot, pt. 2 (Amiga/PC *USA*)"},
+	{0xb6ac, 0xc6, 0xaea0, "Lancelot, pt. 3 (Amiga/PC *USA*)"},
+
+	{0x8afc, 0x07, 0x8321, "Lancelot, pt. 1 (Commodore 64 Gfx *USA*)"},
+	{0x8aec, 0x13, 0x6791, "Lancelot, pt. 2 (Commodore 64 Gfx *USA*)"},
+	{0x8aba, 0x0d, 0x5602, "Lancelot, pt. 3 (Commodore 64 Gfx *USA*)"},
+
+	{0xd19b, 0xad, 0x306d, "Ingrid's Back, pt. 1 (PC)"},
+	{0xc5a5, 0xfe, 0x3c98, "Ingrid's Back, pt. 2 (PC)"},
+	{0xd7ae, 0x9e, 0x1878, "Ingrid's Back, pt. 3 (PC)"},
+
+	{0xd188, 0x13, 0xdc60, "Ingrid's Back, pt. 1 (Amiga)"},
+	{0xc594, 0x03, 0xea95, "Ingrid's Back, pt. 2 (Amiga)"},
+	{0xd79f, 0xb5, 0x1661, "Ingrid's Back, pt. 3 (Amiga)"},
+
+	{0xd183, 0x83, 0xef72, "Ingrid's Back, pt. 1 (ST)"},
+	{0xc58f, 0x65, 0xf337, "Ingrid's Back, pt. 2 (ST)"},
+	{0xd79a, 0x57, 0x49c5, "Ingrid's Back, pt. 3 (ST)"},
+
+	{0xb770, 0x03, 0x9a03, "Ingrid's Back, pt. 1 (Commodore 64 TO)"},
+	{0xb741, 0xb6, 0x2aa5, "Ingrid's Back, pt. 2 (Commodore 64 TO)"},
+	{0xb791, 0xa1, 0xd065, "Ingrid's Back, pt. 3 (Commodore 64 TO)"},
+
+	{0x9089, 0xce, 0xc5e2, "Ingrid's Back, pt. 1 (Commodore 64 Gfx)"},
+	{0x908d, 0x80, 0x30c7, "Ingrid's Back, pt. 2 (Commodore 64 Gfx)"},
+	{0x909e, 0x9f, 0xdecc, "Ingrid's Back, pt. 3 (Commodore 64 Gfx)"},
+
+	{0x8ab7, 0x68, 0xee57, "Ingrid's Back, pt. 1 (Spectrum 48)"},
+	{0x8b1e, 0x84, 0x2538, "Ingrid's Back, pt. 2 (Spectrum 48)"},
+	{0x8b1c, 0xa8, 0x9262, "Ingrid's Back, pt. 3 (Spectrum 48)"},
+
+	{0xbeab, 0x2d, 0x94d9, "Scapeghost, pt. 1 (Amiga)"},
+	{0xc132, 0x14, 0x7adc, "Scapeghost, pt. 1 (Amiga *bak*)"},
+	{0xbe94, 0xcc, 0x04b8, "Scapeghost, pt. 1 (PC/ST)"},
+	{0x99bd, 0x65, 0x032e, "Scapeghost, pt. 2 (Amiga/PC/ST)"},
+	{0xbcb6, 0x7a, 0x7d4f, "Scapeghost, pt. 3 (Amiga/PC/ST)"},
+
+	{0x9058, 0xcf, 0x9748, "Scapeghost, pt. 1 (Commodore 64 Gfx)"},
+	{0x8f43, 0xc9, 0xeefd, "Scapeghost, pt. 2 (Commodore 64 Gfx)"},
+	{0x90ac, 0x68, 0xb4a8, "Scapeghost, pt. 3 (Commodore 64 Gfx)"},
+
+	{0x8a21, 0xf4, 0xd9e4, "Scapeghost, pt. 1 (Spectrum 48)"},
+	{0x8a12, 0xe3, 0xc2ff, "Scapeghost, pt. 2 (Spectrum 48)"},
+	{0x8a16, 0xcc, 0x4f3b, "Scapeghost, pt. 3 (Spectrum 48)"},
+
+	{0x3ebb, 0x00, 0xf6dc, "Champion of the Raj (English) 1/2 GD (Amiga)"},
+	{0x0fd8, 0x00, 0xf250, "Champion of the Raj (English) 2/2 GD (Amiga)"},
+
+	{0x3e8f, 0x00, 0x5599, "Champion of the Raj (English) 1/2 GD (ST)"},
+
+	{0x3e4f, 0x00, 0xb202, "Champion of the Raj (English) 1/2 GD (PC)"},
+	{0x14a3, 0x00, 0xa288, "Champion of the Raj (English) 2/2 GD (PC)"},
+
+	{0x1929, 0x00, 0xd4b2, "Champion of the Raj (demo), 1/2 GD (ST)"},
+	{0x40e0, 0x02, 0x080d, "Champion of the Raj (demo), 2/2 GD (ST)"},
+
+	{0x4872, 0x00, 0x9515, "Champion of the Raj (German) 1/2 GD (Amiga)"},
+	{0x11f5, 0x00, 0xbf39, "Champion of the Raj (German) 2/2 GD (Amiga)"},
+
+	{0x4846, 0x00, 0xd9c1, "Champion of the Raj (German) 1/2 GD (ST)"},
+	{0x11f5, 0x00, 0x7aa4, "Champion of the Raj (German) 2/2 GD (ST)"},
+
+	{0x110f, 0x00, 0x4b57, "Champion of the Raj (French) 2/2 GD (ST)"},
+
+	{0x0000, 0x00, 0x0000, NULL}
+};
+
+/* Patched versions of known games, from L9cut's l9data_p.h (version 012,
+   22 May 2001), giving the checksum and CRC of the original data */
+struct L9GamePatch
 {
-	L9BYTE dictVal1, dictVal2;
-	int dictStart, L9Ptrs[5], absData, msgStart, msgLen;
+	L9UINT16 length;
+	L9BYTE origchecksum;
+	L9UINT16 origcrc;
+	L9BYTE patchchecksum;
+	L9UINT16 patchcrc;
 };
-struct L9V1GameInfo L9V1Games[] =
+struct L9GamePatch L9GamePatches[] =
 {
-	0x1a,0x24,301, 0x0000,-0x004b, 0x0080,-0x002b, 0x00d0,0x03b0, 0x0f80,0x4857, /* Colossal Adventure */
-	0x20,0x3b,283,-0x0583, 0x0000,-0x0508,-0x04e0, 0x0000,0x0800, 0x1000,0x39d1, /* Adventure Quest */
-	0x14,0xff,153,-0x00d6, 0x0000, 0x0000, 0x0000, 0x0000,0x0a20, 0x16bf,0x420d, /* Dungeon Adventure */
-	0x15,0x5d,252,-0x3e70, 0x0000,-0x3d30,-0x3ca0, 0x0100,0x4120,-0x3b9d,0x3988, /* Lords of Time */
-	0x15,0x6c,284,-0x00f0, 0x0000,-0x0050,-0x0050,-0x0050,0x0300, 0x1930,0x3c17, /* Snowball */
+	/* Price of Magik (Spectrum128) */
+	{0x7410, 0x5e, 0x60be, 0x70, 0x6cef},
+
+	/* Price of Magik (Commodore 64) */
+	{0x6fc6, 0x14, 0xf9b6, 0x26, 0x3326},
+
+	/* Price of Magik (Spectrum48) */
+	{0x5aa4, 0xc1, 0xeda4, 0xd3, 0xed35},
+	{0x5aa4, 0xc1, 0xeda4, 0xc1, 0x8a65},
+
+	/* Colossal Adventure /JoD (Amiga/PC) */
+	{0x76f4, 0x5e, 0x1fe5, 0xea, 0x1305},
+	{0x76f4, 0x5e, 0x1fe5, 0xb5, 0x901f},
+	{0x76f4, 0x5e, 0x1fe5, 0x5e, 0x6ea1},
+
+	/* Colossal Adventure /JoD (ST) */
+	{0x76f4, 0x5a, 0xcf4b, 0xe6, 0x012a},
+	{0x76f4, 0x5a, 0xcf4b, 0xb1, 0x40b1},
+
+	/* Adventure Quest /JoD (Amiga/PC) */
+	{0x6e60, 0x83, 0x18e0, 0x4c, 0xcfb0},
+	{0x6e60, 0x83, 0x18e0, 0xfa, 0x9b3b},
+	{0x6e60, 0x83, 0x18e0, 0x83, 0x303d},
+
+	/* Adventure Quest /JoD (ST) */
+	{0x6e5c, 0xf6, 0xd356, 0xbf, 0xede7},
+	{0x6e5c, 0xf6, 0xd356, 0x6d, 0x662d},
+
+	/* Dungeon Adventure /JoD (Amiga/PC/ST) */
+	{0x6f0c, 0x95, 0x1f64, 0x6d, 0x2443},
+	{0x6f0c, 0x95, 0x1f64, 0x0c, 0x6066},
+	{0x6f0c, 0x95, 0x1f64, 0x96, 0xdaca},
+	{0x6f0c, 0x95, 0x1f64, 0x95, 0x848d},
+
+	/* Colossal Adventure /JoD (Spectrum128) */
+	{0x6f6e, 0x78, 0x28cd, 0xf8, 0xda5f},
+	{0x6f6e, 0x78, 0x28cd, 0x77, 0x5b4e},
+
+	/* Adventure Quest /JoD (Spectrum128) */
+	{0x6970, 0xd6, 0xa820, 0x3b, 0x1870},
+	{0x6970, 0xd6, 0xa820, 0xd5, 0x13c4},
+
+	/* Dungeon Adventure /JoD (Spectrum128) */
+	{0x6de8, 0x4c, 0xd795, 0xa2, 0x3eea},
+	{0x6de8, 0x4c, 0xd795, 0x4b, 0xad30},
+
+	/* Colossal Adventure /JoD (Amstrad CPC) */
+	{0x6f4d, 0xcb, 0xe8f2, 0x4b, 0xb384},
+	{0x6f4d, 0xcb, 0xe8f2, 0xca, 0x96e7},
+
+	/* Adventure Quest /JoD (Amstrad CPC) */
+	{0x6968, 0x32, 0x0c01, 0x97, 0xdded},
+	{0x6968, 0x32, 0x0c01, 0x31, 0xe8c2},
+
+	/* Dungeon Adventure /JoD (Amstrad CPC) */
+	{0x6dc0, 0x63, 0x5d95, 0xb9, 0xc963},
+	{0x6dc0, 0x63, 0x5d95, 0x62, 0x79f7},
+
+	/* Colossal Adventure /JoD (Commodore 64) */
+	{0x6c8e, 0xb6, 0x9be3, 0x36, 0x6971},
+	{0x6c8e, 0xb6, 0x9be3, 0xb5, 0xeba0},
+
+	/* Adventure Quest /JoD (Commodore 64) */
+	{0x63b6, 0x2e, 0xef38, 0x93, 0x4e68},
+	{0x63b6, 0x2e, 0xef38, 0x2d, 0x54dc},
+
+	/* Dungeon Adventure /JoD (Commodore 64) */
+	{0x6bd2, 0x65, 0xa41f, 0xbb, 0x4260},
+	{0x6bd2, 0x65, 0xa41f, 0x64, 0xdf5a},
+
+	/* Colossal Adventure /JoD (Spectrum48) */
+	{0x5a8e, 0xf2, 0x7cca, 0x72, 0x8e58},
+	{0x5a8e, 0xf2, 0x7cca, 0xf1, 0x0c89},
+	{0x5a8e, 0xf2, 0x7cca, 0xf2, 0x2c96},
+
+	/* Adventure Quest /JoD (Spectrum48) */
+	{0x5ace, 0x11, 0xdc12, 0x76, 0x8663},
+	{0x5ace, 0x11, 0xdc12, 0x10, 0xa757},
+	{0x5ace, 0x11, 0xdc12, 0x11, 0xf118},
+
+	/* Dungeon Adventure /JoD (Spectrum48) */
+	{0x58a3, 0x38, 0x8ce4, 0x8e, 0xb61a},
+	{0x58a3, 0x38, 0x8ce4, 0x37, 0x34c0},
+	{0x58a3, 0x38, 0x8ce4, 0x38, 0xa1ee},
+
+	/* Snowball /SD (Amiga/ST) */
+	{0x7b31, 0x6e, 0x2e2b, 0xe5, 0x6017},
+
+	/* Return to Eden /SD (Amiga/ST) */
+	{0x7d16, 0xe6, 0x5438, 0x5d, 0xc770},
+
+	/* Worm in Paradise /SD (Amiga/ST) */
+	{0x7cd9, 0x0c, 0x4df1, 0x83, 0xe997},
+
+	/* Snowball /SD (PC/Spectrum128) */
+	{0x7b2f, 0x70, 0x6955, 0xe7, 0x0af4},
+	{0x7b2f, 0x70, 0x6955, 0x70, 0x1179},
+
+	/* Return to Eden /SD (PC) */
+	{0x7d14, 0xe8, 0xfbab, 0x5f, 0xeab9},
+	{0x7d14, 0xe8, 0xfbab, 0xe8, 0xe216},
+
+	/* Return to Eden /SD (Amstrad CPC) */
+	{0x7cff, 0xf8, 0x6044, 0x6f, 0xbb57},
+
+	/* Return to Eden /SD (Spectrum128) */
+	{0x7c55, 0x18, 0xdaee, 0x8f, 0x01fd},
+
+	/* Worm in Paradise /SD (Amstrad CPC/PC/Spectrum128) */
+	{0x7cd7, 0x0e, 0x4feb, 0x85, 0x4eae},
+	{0x7cd7, 0x0e, 0x4feb, 0x0e, 0xb02c},
+
+	/* Snowball /SD (Commodore 64) */
+	{0x7363, 0x65, 0xa0ab, 0xdc, 0xca6a},
+
+	/* Return to Eden /SD (Commodore 64) */
+	{0x772f, 0xca, 0x8602, 0x41, 0x9bd0},
+
+	/* Worm in Paradise /SD (Commodore 64) */
+	{0x788d, 0x72, 0x888a, 0xe9, 0x4cce},
+
+	/* Snowball /SD (Atari) */
+	{0x6bf8, 0x3f, 0xc9f7, 0x96, 0x1908},
+
+	/* Return to Eden /SD (Atari) */
+	{0x60f7, 0x68, 0xc2bc, 0xdf, 0xd3ae},
+
+	/* Worm in Paradise /SD (Atari) */
+	{0x6161, 0xf3, 0xe6d7, 0x6a, 0xe232},
+
+	/* Snowball /SD (Spectrum48) */
+	{0x6541, 0x02, 0x2e6c, 0x79, 0xb80c},
+	{0x6541, 0x02, 0x2e6c, 0x02, 0x028a},
+
+	/* Return to Eden /SD (Spectrum48) */
+	{0x5f43, 0xca, 0x828c, 0x41, 0x9f5e},
+	{0x5f43, 0xca, 0x828c, 0xca, 0x6e1b},
+
+	/* Worm in Paradise /SD (Spectrum48) */
+	{0x5ebb, 0xf1, 0x4dec, 0x68, 0x4909},
+	{0x5ebb, 0xf1, 0x4dec, 0xf1, 0xcc1a},
+
+	/* Knight Orc, pt. 1 (Amiga) */
+	{0xbb93, 0x36, 0x6a05, 0xad, 0xe52d},
+
+	/* Knight Orc, pt. 1 (ST) */
+	{0xbb6e, 0xad, 0x4d40, 0x24, 0x3bcd},
+
+	/* Knight Orc, pt. 2 (Amiga/ST) */
+	{0xc58e, 0x4a, 0x4e9d, 0xc1, 0xe2bf},
+
+	/* Knight Orc, pt. 3 (Amiga/ST) */
+	{0xcb9a, 0x0f, 0x0804, 0x86, 0x6487},
+
+	/* Knight Orc, pt. 1 (PC) */
+	{0xbb6e, 0xa6, 0x9753, 0x1d, 0x2e7f},
+	{0xbb6e, 0xa6, 0x9753, 0xa6, 0x001d},
+
+	/* Knight Orc, pt. 2 (PC) */
+	{0xc58e, 0x43, 0xe9ce, 0xba, 0x5e4c},
+	{0xc58e, 0x43, 0xe9ce, 0x43, 0xa8f0},
+
+	/* Knight Orc, pt. 3 (PC) */
+	{0xcb9a, 0x08, 0x6c36, 0x7f, 0xf0d4},
+	{0xcb9a, 0x08, 0x6c36, 0x08, 0x2d08},
+
+	/* Knight Orc, pt. 1 (Commodore 64 Gfx) */
+	{0x8970, 0x6b, 0x3c7b, 0xe2, 0xb6f3},
+
+	/* Knight Orc, pt. 1 (Spectrum48) */
+	{0x86d0, 0xb7, 0xadbd, 0x2e, 0x43e1},
+
+	/* Gnome Ranger, pt. 1 (Amiga/ST) */
+	{0xb1a9, 0x80, 0x5fb7, 0xf7, 0x5c6c},
+
+	/* Gnome Ranger, pt. 2 (Amiga/ST) */
+	{0xab9d, 0x31, 0xbe6d, 0xa8, 0xcb96},
+
+	/* Gnome Ranger, pt. 3 (Amiga/ST) */
+	{0xae28, 0x87, 0xb6b6, 0xfe, 0x760c},
+
+	/* Gnome Ranger, pt. 1 (PC) */
+	{0xb1aa, 0xad, 0xaf47, 0x24, 0x5cfd},
+	{0xb1aa, 0xad, 0xaf47, 0xad, 0xe0ed},
+
+	/* Gnome Ranger, pt. 1 (ST-var) */
+	{0xb19e, 0x92, 0x8f96, 0x09, 0x798c},
+
+	/* Gnome Ranger, pt. 2 (PC/ST-var) */
+	{0xab8b, 0xbf, 0x31e6, 0x36, 0x811c},
+	{0xab8b, 0xbf, 0x31e6, 0xbf, 0x8ff3},
+
+	/* Gnome Ranger, pt. 3 (PC/ST-var) */
+	{0xae16, 0x81, 0x8741, 0xf8, 0x47fb},
+	{0xae16, 0x81, 0x8741, 0x81, 0xc8eb},
+
+	/* Gnome Ranger, pt. 1 (Commodore 64 TO) */
+	{0xad41, 0xa8, 0x42c5, 0x1f, 0x7d1e},
+
+	/* Gnome Ranger, pt. 2 (Commodore 64 TO) */
+	{0xa735, 0xf7, 0x2e08, 0x6e, 0x780e},
+
+	/* Gnome Ranger, pt. 3 (Commodore 64 TO) */
+	{0xa9c0, 0x9e, 0x0d70, 0x15, 0x3e6b},
+
+	/* Gnome Ranger, pt. 1 (Commodore 64 Gfx) */
+	{0x908e, 0x0d, 0x58a7, 0x84, 0xab1d},
+
+	/* Gnome Ranger, pt. 2 (Commodore 64 Gfx) */
+	{0x8f6f, 0x0a, 0x411a, 0x81, 0x12bc},
+
+	/* Gnome Ranger, pt. 3 (Commodore 64 Gfx) */
+	{0x9060, 0xbb, 0xe75d, 0x32, 0x14e7},
+
+	/* Lords of Time /T&M (PC) */
+	{0xb57c, 0x44, 0x7779, 0xbb, 0x31a6},
+	{0xb57c, 0x44, 0x7779, 0x44, 0xea72},
+
+	/* Red Moon /T&M (PC) */
+	{0xa69e, 0x6c, 0xb268, 0xe3, 0x4cef},
+	{0xa69e, 0x6c, 0xb268, 0x6c, 0x3799},
+
+	/* Price of Magik /T&M (PC) */
+	{0xbac7, 0x7f, 0xddb2, 0xf6, 0x6ab3},
+	{0xbac7, 0x7f, 0xddb2, 0x7f, 0x905c},
+
+	/* Lords of Time /T&M (ST) */
+	{0xb579, 0x89, 0x3e89, 0x00, 0xa2b7},
+
+	/* Red Moon /T&M (ST) */
+	{0xa698, 0x41, 0xcaca, 0xb8, 0xeeac},
+
+	/* Price of Magik /T&M (ST) */
+	{0xbac4, 0x80, 0xa750, 0xf7, 0xe030},
+
+	/* Lords of Time /T&M (Amiga) */
+	{0xb576, 0x2a, 0x7239, 0xa1, 0x2ea6},
+
+	/* Red Moon /T&M (Amiga) */
+	{0xa692, 0xd1, 0x6a99, 0x48, 0x50ff},
+
+	/* Price of Magik /T&M (Amiga) */
+	{0xbaca, 0x3a, 0x221b, 0xb1, 0x55bb},
+
+	/* Lords of Time /T&M (Commodore 64 TO) */
+	{0xb38c, 0x37, 0x9f8e, 0xae, 0xc6b1},
+
+	/* Red Moon /T&M (Commodore 64 TO) */
+	{0xa4e2, 0xa6, 0x016d, 0x1d, 0x31ab},
+
+	/* Price of Magik /T&M (Commodore 64 TO) */
+	{0xb451, 0xa8, 0x2682, 0x1f, 0x5de2},
+
+	/* Lords of Time /T&M (Commodore 64 Gfx) */
+	{0x9070, 0x43, 0x45d4, 0xba, 0x02eb},
+
+	/* Red Moon /T&M (Commodore 64 Gfx) */
+	{0x903f, 0x6b, 0x603e, 0xe2, 0x9f59},
+
+	/* Price of Magik /T&M (Commodore 64 Gfx) */
+	{0x8f51, 0xb2, 0x6c9a, 0x29, 0xde3b},
+
+	/* Lords of Time /T&M (Spectrum48) */
+	{0x8950, 0xa1, 0xbb16, 0x18, 0x2828},
+	{0x8950, 0xa1, 0xbb16, 0xa1, 0x1ea2},
+
+	/* Red Moon /T&M (Spectrum48) */
+	{0x8813, 0x11, 0x22de, 0x88, 0x18b8},
+	{0x8813, 0x11, 0x22de, 0x11, 0xd0cd},
+
+	/* Price of Magik /T&M (Spectrum48) */
+	{0x8a60, 0x2a, 0x29ed, 0xa1, 0x5e4d},
+
+	/* Lancelot, pt. 1 (Amiga/PC/ST) */
+	{0xc0cf, 0x4e, 0xb7fa, 0xc5, 0x4400},
+
+	/* Lancelot, pt. 2 (Amiga/PC/ST) */
+	{0xd5e9, 0x6a, 0x4192, 0xe1, 0x3b1e},
+
+	/* Lancelot, pt. 3 (Amiga/PC/ST) */
+	{0xbb8f, 0x1a, 0x7487, 0x91, 0x877d},
+
+	/* Lancelot, pt. 1 (Commodore 64 TO) */
+	{0xb4c9, 0x94, 0xd784, 0x0b, 0x203e},
+
+	/* Lancelot, pt. 2 (Commodore 64 TO) */
+	{0xb729, 0x51, 0x8ee5, 0xc8, 0xf1c9},
+
+	/* Lancelot, pt. 3 (Commodore 64 TO) */
+	{0xb702, 0xe4, 0x1809, 0x5b, 0x25b2},
+
+	/* Lancelot, pt. 1 (Commodore 64 Gfx) */
+	{0x8feb, 0xba, 0xa800, 0x31, 0x5bfa},
+
+	/* Lancelot, pt. 2 (Commodore 64 Gfx) */
+	{0x8f6b, 0xfa, 0x0f7e, 0x71, 0x75f2},
+
+	/* Lancelot, pt. 3 (Commodore 64 Gfx) */
+	{0x8f71, 0x2f, 0x0ddc, 0xa6, 0x3e87},
+
+	/* Ingrid's Back, pt. 1 (PC) */
+	{0xd19b, 0xad, 0x306d, 0x24, 0x4504},
+	{0xd19b, 0xad, 0x306d, 0xad, 0x878e},
+
+	/* Ingrid's Back, pt. 2 (PC) */
+	{0xc5a5, 0xfe, 0x3c98, 0x75, 0x8950},
+	{0xc5a5, 0xfe, 0x3c98, 0xfe, 0x8b7b},
+
+	/* Ingrid's Back, pt. 3 (PC) */
+	{0xd7ae, 0x9e, 0x1878, 0x15, 0xadb0},
+	{0xd7ae, 0x9e, 0x1878, 0x9e, 0xaf9b},
+
+	/* Ingrid's Back, pt. 1 (Amiga) */
+	{0xd188, 0x13, 0xdc60, 0x8a, 0x755c},
+
+	/* Ingrid's Back, pt. 2 (Amiga) */
+	{0xc594, 0x03, 0xea95, 0x7a, 0xb5a8},
+
+	/* Ingrid's Back, pt. 3 (Amiga) */
+	{0xd79f, 0xb5, 0x1661, 0x2c, 0xbf5d},
+
+	/* Ingrid's Back, pt. 1 (ST) */
+	{0xd183, 0x83, 0xef72, 0xfa, 0xb04f},
+
+	/* Ingrid's Back, pt. 2 (ST) */
+	{0xc58f, 0x65, 0xf337, 0xdc, 0x900a},
+
+	/* Ingrid's Back, pt. 3 (ST) */
+	{0xd79a, 0x57, 0x49c5, 0xce, 0xe0f9},
+
+	/* Ingrid's Back, pt. 1 (Commodore 64 TO) */
+	{0xb770, 0x03, 0x9a03, 0x7a, 0xdc6a},
+
+	/* Ingrid's Back, pt. 2 (Commodore 64 TO) */
+	{0xb741, 0xb6, 0x2aa5, 0x2d, 0x5a6c},
+
+	/* Ingrid's Back, pt. 3 (Commodore 64 TO) */
+	{0xb791, 0xa1, 0xd065, 0x18, 0xaa0c},
+
+	/* Ingrid's Back, pt. 1 (Commodore 64 Gfx) */
+	{0x9089, 0xce, 0xc5e2, 0x44, 0xeff4},
+
+	/* Ingrid's Back, pt. 2 (Commodore 64 Gfx) */
+	{0x908d, 0x80, 0x30c7, 0xf6, 0x2a11},
+
+	/* Ingrid's Back, pt. 3 (Commodore 64 Gfx) */
+	{0x909e, 0x9f, 0xdecc, 0x15, 0xf4da},
+
+	{0x0000, 0x00, 0x0000, 0x00, 0x0000},
 };
-int L9V1Game = -1;
 
 
 /* Prototypes */
@@ -172,95 +970,23 @@ int getlongcode(void);
 L9BOOL GetWordV2(char *buff,int Word);
 L9BOOL GetWordV3(char *buff,int Word);
 void show_picture(int pic);
-
-
-#ifdef CODEFOLLOW
-#define CODEFOLLOWFILE "c:\\temp\\level9.txt"
-FILE *f;
-L9UINT16 *cfvar,*cfvar2;
-char *codes[]=
-{
-	"Goto",
-	"intgosub",
-	"intreturn",
-	"printnumber",
-	"messagev",
-	"messagec",
-	"function",
-	"input",
-	"varcon",
-	"varvar",
-	"_add",
-	"_sub",
-	"ilins",
-	"ilins",
-	"jump",
-	"Exit",
-	"ifeqvt",
-	"ifnevt",
-	"ifltvt",
-	"ifgtvt",
-	"screen",
-	"cleartg",
-	"picture",
-	"getnextobject",
-	"ifeqct",
-	"ifnect",
-	"ifltct",
-	"ifgtct",
-	"printinput",
-	"ilins",
-	"ilins",
-	"ilins",
-};
-char *functions[]=
-{
-	"calldriver",
-	"L9Random",
-	"save",
-	"restore",
-	"clearworkspace",
-	"clearstack"
-};
-char *drivercalls[]=
-{
-	"init",
-	"drivercalcchecksum",
-	"driveroswrch",
-	"driverosrdch",
-	"driverinputline",
-	"driversavefile",
-	"driverloadfile",
-	"settext",
-	"resettask",
-	"returntogem",
-	"10 *",
-	"loadgamedatafile",
-	"randomnumber",
-	"13 *",
-	"driver14",
-	"15 *",
-	"driverclg",
-	"line",
-	"fill",
-	"driverchgcol",
-	"20 *",
-	"21 *",
-	"ramsave",
-	"ramload",
-	"24 *",
-	"lensdisplay",
-	"26 *",
-	"27 *",
-	"28 *",
-	"29 *",
-	"allocspace",
-	"31 *",
-	"showbitmap",
-	"33 *",
-	"checkfordisc"
-};
+void indexsubs(void);
+void loadmemoryused(L9UINT32 bytes);
+#ifdef L9PRELOAD
+L9BOOL takepreload(char* filename);
+void stoppreloads(void);
 #endif
+#ifdef PREDECODE
+void irflush(void);
+void irreset(void);
+#endif
+#ifdef FUSEDOPS
+void irreport(void);
+#endif
+#ifdef AOTCODE
+void aotcheck(void);
+#endif
+
 
 void initdict(L9BYTE *ptr)
 {
@@ -351,6 +1077,10 @@ void error(char *fmt,...)
 	char buf[256];
 	int i;
 	va_list ap;
+#ifdef L9PRELOAD
+	/* a part loaded in the background has no say until it is played */
+	if (preloading) return;
+#endif
 	va_start(ap,fmt);
 	vsprintf(buf,fmt,ap);
 	va_end(ap);
@@ -375,8 +1105,6 @@ void printautocase(int d0)
 
 void displaywordref(L9UINT16 Off)
 {
-	static int mdtmode=0;
-
 	wordcase=0;
 	d5=(Off>>12)&7;
 	Off&=0xfff;
@@ -534,6 +1262,33 @@ int msglenV2(L9BYTE **ptr)
 	return i;
 }
 
+int msglenV1(L9BYTE **ptr)
+{
+	L9BYTE *ptr2=*ptr;
+	while (ptr2<startdata+FileSize && *ptr2++!=1);
+	return ptr2-*ptr;
+}
+
+/* returns the start of the message n on from ptr, which is startmd or
+   the start of the abbreviations, using the starts kept by indexmessages() */
+L9BYTE* skipmessages(L9BYTE *ptr,int n,L9BOOL V2)
+{
+	int k;
+
+	if (msgindexed && n>0)
+	{
+		k=n<MSGINDEXSIZE ? n : MSGINDEXSIZE-1;
+		ptr=startfile+msgindex[(ptr==startmd ? 0 : MSGINDEXSIZE)+k];
+		n-=k;
+	}
+	while (n-->0)
+	{
+		if (V2) ptr+=msglenV2(&ptr);
+		else ptr+=msglenV1(&ptr);
+	}
+	return ptr;
+}
+
 void printcharV2(char c)
 {
 	if (c==0x25) c=0xd;
@@ -546,10 +1301,7 @@ void displaywordV2(L9BYTE *ptr,int msg)
 	int n;
 	L9BYTE a;
 	if (msg==0) return;
-	while (--msg)
-	{
-		ptr+=msglenV2(&ptr);
-	}
+	ptr=skipmessages(ptr,msg-1,TRUE);
 	n=msglenV2(&ptr);
 
 	while (--n>0)
@@ -562,21 +1314,11 @@ void displaywordV2(L9BYTE *ptr,int msg)
 	}
 }
 
-int msglenV1(L9BYTE **ptr)
-{
-	L9BYTE *ptr2=*ptr;
-	while (ptr2<startdata+FileSize && *ptr2++!=1);
-	return ptr2-*ptr;
-}
-
 void displaywordV1(L9BYTE *ptr,int msg)
 {
 	int n;
 	L9BYTE a;
-	while (msg--)
-	{
-		ptr+=msglenV1(&ptr);
-	}
+	ptr=skipmessages(ptr,msg,FALSE);
 	n=msglenV1(&ptr);
 
 	while (--n>0)
@@ -589,69 +1331,79 @@ void displaywordV1(L9BYTE *ptr,int msg)
 	}
 }
 
-L9BOOL amessageV2(L9BYTE *ptr,int msg,long *w,long *c)
+/* finds the start of each of the first MSGINDEXSIZE messages, and of as
+   many abbreviations, in one pass over each, for the V2 or V1 message
+   format, so that they need not be counted through from the start; the
+   index is only allocated for the games that use it */
+void indexmessages(L9BOOL V2)
 {
-	int n;
-	L9BYTE a;
-	static int depth=0;
-	if (msg==0) return FALSE;
-	while (--msg)
+	L9BYTE *ptr;
+	int i;
+
+	msgindexed=FALSE;
+	if (msgindex==NULL && (msgindex=malloc(2*MSGINDEXSIZE*sizeof(L9UINT32)))==NULL)
+		return;
+	ptr=startmd;
+	for (i=0;i<MSGINDEXSIZE;i++)
 	{
-		ptr+=msglenV2(&ptr);
+		msgindex[i]=ptr-startfile;
+		if (V2) ptr+=msglenV2(&ptr);
+		else ptr+=msglenV1(&ptr);
 	}
-	if (ptr >= startdata+FileSize) return FALSE;
-	n=msglenV2(&ptr);
-
-	while (--n>0)
+	ptr=V2 ? startmdV2-1 : startmdV2;
+	for (i=0;i<MSGINDEXSIZE;i++)
 	{
-		a=*++ptr;
-		if (a<3) return TRUE;
-
-		if (a>=0x5e)
-		{
-			if (++depth>10 || !amessageV2(startmdV2-1,a-0x5d,w,c))
-			{
-				depth--;
-				return FALSE;
-			}
-			depth--;
-		}
-		else
-		{
-			char ch=a+0x1d;
-			if (ch==0x5f || ch==' ') (*w)++;
-			else (*c)++;
-		}
+		msgindex[MSGINDEXSIZE+i]=ptr-startfile;
+		if (V2) ptr+=msglenV2(&ptr);
+		else ptr+=msglenV1(&ptr);
 	}
-	return TRUE;
+	msgindexed=TRUE;
 }
 
-L9BOOL amessageV1(L9BYTE *ptr,int msg,long *w,long *c)
+/* what amessage() finds in an abbreviation */
+typedef struct
 {
-	int n;
+	long w,c;
+	int depth;	/* abbreviations nested, counting itself; 0 if not known yet, -1 while being worked out */
+	L9BOOL valid;
+} MsgStats;
+
+/* counts the word breaks and other characters of the message n on from
+   ptr, adding them to w and c, and sets depth to how deeply abbreviations
+   are nested in it. Each abbreviation is counted once, and kept in
+   abbrevs. Returns FALSE if the message is past the end of the data, or
+   abbreviations nest more than 10 deep, as they do if one includes itself. */
+L9BOOL amessage(L9BYTE *ptr,int n,L9BOOL V2,MsgStats *abbrevs,int *depth,long *w,long *c)
+{
+	MsgStats *s;
+	int len,d;
 	L9BYTE a;
-	static int depth=0;
 
-	while (msg--)
-	{
-		ptr+=msglenV1(&ptr);
-	}
+	*depth=0;
+	ptr=skipmessages(ptr,n,V2);
 	if (ptr >= startdata+FileSize) return FALSE;
-	n=msglenV1(&ptr);
+	len=V2 ? msglenV2(&ptr) : msglenV1(&ptr);
 
-	while (--n>0)
+	while (--len>0)
 	{
-		a=*ptr++;
+		a=V2 ? *++ptr : *ptr++;
 		if (a<3) return TRUE;
 
 		if (a>=0x5e)
 		{
-			if (++depth>10 || !amessageV1(startmdV2,a-0x5e,w,c))
+			s=abbrevs+a-0x5e;
+			if (s->depth==0)
 			{
-				depth--;
-				return FALSE;
+				s->depth=-1;
+				s->w=s->c=0;
+				s->valid=amessage(V2 ? startmdV2-1 : startmdV2,a-0x5e,V2,abbrevs,&d,&s->w,&s->c);
+				s->depth=d+1;
 			}
-			depth--;
+			if (s->depth<0 || !s->valid || s->depth>10)
+				return FALSE;
+			if (s->depth>*depth) *depth=s->depth;
+			(*w)+=s->w;
+			(*c)+=s->c;
 		}
 		else
 		{
@@ -663,41 +1415,36 @@ L9BOOL amessageV1(L9BYTE *ptr,int msg,long *w,long *c)
 	return TRUE;
 }
 
-L9BOOL analyseV2(double *wl)
+/* works out the average word length of the first 255 messages, in the V2
+   format, or 256 in the V1 format, returning FALSE if any cannot be read;
+   the message starts are left in the index */
+L9BOOL analysemessages(L9BOOL V2,double *wl)
 {
+	MsgStats *abbrevs=calloc(0x100-0x5e,sizeof(MsgStats));
 	long words=0,chars=0;
-	int i;
-	for (i=1;i<256;i++)
-	{
-		long w=0,c=0;
-		if (amessageV2(startmd,i,&w,&c))
-		{
-			words+=w;
-			chars+=c;
-		}
-		else return FALSE;
-	}
+	int i,depth;
+	L9BOOL valid=TRUE;
+
+	if (abbrevs==NULL) return FALSE;
+	loadmemoryused((0x100-0x5e)*sizeof(MsgStats));
+	indexmessages(V2);
+	for (i=0;i<(V2 ? 255 : 256) && valid;i++)
+		valid=amessage(startmd,i,V2,abbrevs,&depth,&words,&chars);
+	free(abbrevs);
+	if (!valid) return FALSE;
+
 	*wl=words ? (double) chars/words : 0.0;
 	return TRUE;
 }
 
-L9BOOL analyseV1(double *wl)
+L9BOOL analyseV2(double *wl)
 {
-	long words=0,chars=0;
-	int i;
-	for (i=0;i<256;i++)
-	{
-		long w=0,c=0;
-		if (amessageV1(startmd,i,&w,&c))
-		{
-			words+=w;
-			chars+=c;
-		}
-		else return FALSE;
-	}
+	return analysemessages(TRUE,wl);
+}
 
-	*wl=words ? (double) chars/words : 0.0;
-	return TRUE;
+L9BOOL analyseV1(double *wl)
+{
+	return analysemessages(FALSE,wl);
 }
 
 void printmessageV2(int Msg)
@@ -708,13 +1455,13 @@ void printmessageV2(int Msg)
 
 L9UINT32 filelength(FILE *f)
 {
-	L9UINT32 pos,FileSize;
+	L9UINT32 pos,size;
 
 	pos=ftell(f);
 	fseek(f,0,SEEK_END);
-	FileSize=ftell(f);
+	size=ftell(f);
 	fseek(f,pos,SEEK_SET);
-	return FileSize;
+	return size;
 }
 
 void L9Allocate(L9BYTE **ptr,L9UINT32 Size)
@@ -728,33 +1475,382 @@ void L9Allocate(L9BYTE **ptr,L9UINT32 Size)
 	}
 }
 
+/* reads size bytes from the start of f into memory that can be written to,
+   mapping the file where possible; mapped is set to the size mapped, or to
+   0 if the memory was allocated */
+L9BYTE* readfile(FILE *f,L9UINT32 size,L9UINT32 *mapped)
+{
+	L9BYTE *data=NULL;
+#ifdef L9MMAP
+	L9UINT32 mapsize=(size+MAPSLACK+MAPSLACK-1)&~(L9UINT32)(MAPSLACK-1);
+
+	/* reserve room for the zeros, then map the file over the start of it */
+	data=mmap(NULL,mapsize,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANON,-1,0);
+	if (data!=MAP_FAILED)
+	{
+		if (size>0 && mmap(data,size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_FIXED,fileno(f),0)!=MAP_FAILED)
+		{
+			madvise(data,size,MADV_SEQUENTIAL);
+			*mapped=mapsize;
+			return data;
+		}
+		munmap(data,mapsize);
+	}
+	data=NULL;
+#endif
+	*mapped=0;
+	if ((data=malloc(size))==NULL) return NULL;
+	if (fread(data,1,size,f)!=size)
+	{
+		free(data);
+		return NULL;
+	}
+	return data;
+}
+
+/* frees memory from readfile() */
+void freefile(L9BYTE *data,L9UINT32 mapped)
+{
+#ifdef L9MMAP
+	if (mapped)
+	{
+		munmap(data,mapped);
+		return;
+	}
+#endif
+	free(data);
+}
+
 void FreeMemory(void)
 {
 	if (startfile)
 	{
-		free(startfile);
+		freefile(startfile,startfilemap);
 		startfile=NULL;
+		startfilemap=0;
 	}
+	free(dirtymap);
+	dirtymap=NULL;
 	if (pictureaddress)
 	{
-		free(pictureaddress);
+		if (!sharedpictures) freefile(pictureaddress,picturemap);
 		pictureaddress=NULL;
+		sharedpictures=FALSE;
+		picturemap=0;
 	}
 	if (bitmap)
 	{
 		free(bitmap);
 		bitmap=NULL;
 	}
+	free(msgindex);
+	msgindex=NULL;
+	msgindexed=FALSE;
+	free(subindex);
+	subindex=NULL;
+	subindexed=FALSE;
 	if (scriptfile)
 	{
 		fclose(scriptfile);
 		scriptfile=NULL;
 	}
+	TraceStop();
+	ProfileStop();
+#ifdef L9PRELOAD
+	stoppreloads();
+#endif
 	picturedata=NULL;
 	picturesize=0;
 	gfxa5=NULL;
 }
 
+/* gives the fields of a context that do not start at zero their values */
+void initcontext(L9Context* ctx)
+{
+	L9Context* old=l9ctx;
+
+	l9ctx=ctx;
+	FirstPicture=-1;
+	showtitle=1;
+	L9V1Game=-1;
+	lastchar='.';
+	l9ctx=old;
+}
+
+/* the default context, which starts at zero like any static and is set
+   up as NewContext() sets up the others when it is first bound or loaded
+   into, keeping any settings made in it before then */
+L9Context* defaultcontext(void)
+{
+	if (!l9defaultready)
+	{
+		initcontext(&l9default);
+		l9defaultready=TRUE;
+	}
+	return &l9default;
+}
+
+/* binds the context the other entry points work on in this thread,
+   returning the one bound before. NULL binds the default context. */
+L9Context* SetContext(L9Context* ctx)
+{
+	L9Context* old=l9ctx;
+	l9ctx=ctx ? ctx : defaultcontext();
+	return old;
+}
+
+/* a new context, for a game to be loaded into once it is bound */
+L9Context* NewContext(void)
+{
+	L9Context *ctx=malloc(sizeof(L9Context));
+	if (ctx==NULL) return NULL;
+	memset(ctx,0,sizeof(L9Context));
+	initcontext(ctx);
+	return ctx;
+}
+
+void FreeContext(L9Context* ctx)
+{
+	L9Context* old;
+
+	if (ctx==NULL || ctx==&l9default) return;
+	old=SetContext(ctx);
+	FreeMemory();
+	free(irpool);
+	free(irmap);
+	free(irswitch);
+	free(FusedCount);
+	SetContext(old==ctx ? NULL : old);
+	free(ctx);
+}
+
+/* moves a pointer into the game data or the context of a game being
+   cloned across to the clone, which is bound. Lists can point past the
+   end of the data, so anything outside the context moves with the data,
+   unless only pointers within size bytes of it are to move. */
+L9BYTE* clonepointer(L9BYTE* p,L9BYTE* file,L9UINT32 size,L9Context* from)
+{
+	if (p==NULL) return NULL;
+	if (p>=(L9BYTE*) from && p<(L9BYTE*) (from+1)) return (L9BYTE*) l9ctx+(p-(L9BYTE*) from);
+	if (size>0 && (p<file || p>=file+size)) return p;
+	return startfile+(p-file);
+}
+
+/* a copy of one of ctx's indexes, or NULL if there is no memory for it,
+   when the clone finds its way without it */
+L9UINT32* cloneindex(L9UINT32* index,int size)
+{
+	L9UINT32 *copy;
+
+	if (index==NULL || (copy=malloc(size*sizeof(L9UINT32)))==NULL) return NULL;
+	memcpy(copy,index,size*sizeof(L9UINT32));
+	return copy;
+}
+
+#ifdef L9MMAP
+/* starts a map of the pages of the newly mapped game file that are
+   written to, or leaves none if there is no memory for it */
+void startdirty(void)
+{
+	free(dirtymap);
+	dirtymap=startfilemap ? calloc(IMAGESIZE((startfilemap+DIRTYPAGE-1)/DIRTYPAGE),1) : NULL;
+}
+
+/* maps the file the game in ctx came from afresh for a clone of it, and
+   copies over it only the pages of file marked in dirty, so that the rest
+   is shared with ctx until one of them writes to it. Returns NULL, with
+   mapped 0, if the file cannot be mapped as it was. */
+L9BYTE* remapfile(char* name,L9BYTE* file,L9UINT32 size,L9UINT32 filemap,L9BYTE* dirty,L9UINT32 *mapped)
+{
+	FILE *f=fopen(name,"rb");
+	L9BYTE *data=NULL;
+	L9UINT32 i,n;
+
+	*mapped=0;
+	if (f==NULL) return NULL;
+	if (filelength(f)==size) data=readfile(f,size,mapped);
+	fclose(f);
+	if (data && *mapped!=filemap)
+	{
+		freefile(data,*mapped);
+		*mapped=0;
+		return NULL;
+	}
+	for (i=0;data && i<filemap;i+=n)
+	{
+		n=filemap-i<DIRTYPAGE ? filemap-i : DIRTYPAGE;
+		if (IMAGETEST(dirty,i/DIRTYPAGE)) memcpy(data+i,file+i,n);
+	}
+	return data;
+}
+#endif
+
+/* moves the clone's pointers into the game data, or those of the context
+   it was cloned from, across to the clone, which is bound. If low is not
+   NULL nothing is moved, but it is lowered to the lowest of the pointers
+   that are in the size bytes from file. */
+void clonepointers(L9BYTE* file,L9UINT32 size,L9Context* from,L9BYTE** low)
+{
+	int i;
+
+#define CLONEPTR(p) if (low==NULL) p=clonepointer(p,file,0,from); \
+	else if (p>=file && p<file+size && p<*low) *low=p
+	CLONEPTR(startdata);
+	for (i=0;i<12;i++)
+	{
+		CLONEPTR(L9Pointers[i]);
+		CLONEPTR(L9ListMin[i]);
+		CLONEPTR(L9ListMax[i]);
+	}
+	CLONEPTR(absdatablock);
+	CLONEPTR(list2ptr);
+	CLONEPTR(list3ptr);
+	CLONEPTR(list9startptr);
+	CLONEPTR(acodeptr);
+	CLONEPTR(startmd);
+	CLONEPTR(endmd);
+	CLONEPTR(endwdp5);
+	CLONEPTR(wordtable);
+	CLONEPTR(dictdata);
+	CLONEPTR(defdict);
+	CLONEPTR(startmdV2);
+	CLONEPTR(dictptr);
+	CLONEPTR(codeptr);
+	CLONEPTR(list9ptr);
+	CLONEPTR(ibuffptr);
+#undef CLONEPTR
+}
+
+/* a new context holding the game in ctx as it stands, without loading
+   or scanning it again, or NULL if there is no memory for it. Where the
+   game was mapped the clone maps it again, so that they share the pages
+   neither has written to; otherwise the clone has its own copy of the
+   game's part of the file, as lists can write to it. Either way it
+   shares the picture data, so ctx must be freed after its clones. */
+L9Context* CloneContext(L9Context* ctx)
+{
+	L9Context *clone,*old;
+	L9BYTE *file,*low;
+	L9UINT32 size;
+	int i;
+
+	if (ctx==NULL || (clone=malloc(sizeof(L9Context)))==NULL) return NULL;
+	memcpy(clone,ctx,sizeof(L9Context));
+	old=SetContext(clone);
+
+	file=low=startfile;
+	size=file ? FileSize+(startdata-startfile) : 0;
+	startfile=NULL;
+#ifdef L9MMAP
+	if (file && startfilemap && dirtymap)
+	{
+		/* the clone goes on from the pages ctx has written to */
+		L9BYTE *dirty=dirtymap;
+
+		i=IMAGESIZE((startfilemap+DIRTYPAGE-1)/DIRTYPAGE);
+		if ((dirtymap=malloc(i))!=NULL)
+		{
+			memcpy(dirtymap,dirty,i);
+			startfile=remapfile(LastGame,file,size,startfilemap,dirty,&startfilemap);
+		}
+	}
+	else dirtymap=NULL;
+#endif
+	if (file && startfile==NULL)
+	{
+		/* from as far back as anything points, which is the header
+		   unless a V1 game's code is before its messages */
+		low=startdata;
+		clonepointers(file,size,ctx,&low);
+		startfilemap=0;
+		free(dirtymap);
+		dirtymap=NULL;
+		if ((startfile=malloc(file+size-low))==NULL)
+		{
+			SetContext(old);
+			free(clone);
+			return NULL;
+		}
+		memcpy(startfile,low,file+size-low);
+		/* only the game's part of the file is held, as if streamed */
+		streamed=TRUE;
+	}
+	size-=low-file;
+	/* graphics may be in the shared picture data, or in the part of the file not copied */
+	picturedata=clonepointer(picturedata,low,size,ctx);
+	gfxa5=clonepointer(gfxa5,low,size,ctx);
+	for (i=0;i<GFXSTACKSIZE;i++) GfxA5Stack[i]=clonepointer(GfxA5Stack[i],low,size,ctx);
+	clonepointers(low,size,ctx,NULL);
+
+	/* what is left belongs to ctx alone */
+	if (pictureaddress) sharedpictures=TRUE;
+	bitmap=NULL;
+	ScanCache=FALSE;	/* which ctx's sessions would all be writing */
+	msgindex=cloneindex(msgindex,2*MSGINDEXSIZE);
+	if (msgindex==NULL) msgindexed=FALSE;
+	else for (i=0;i<2*MSGINDEXSIZE;i++) msgindex[i]-=low-file;
+	subindex=cloneindex(subindex,SUBINDEXSIZE);
+	if (subindex==NULL) subindexed=FALSE;
+	scriptfile=NULL;
+	Profiling=FALSE;
+	ProfileCounts=NULL;
+	Tracing=FALSE;
+	tracefile=NULL;
+	tracebuf=NULL;
+	irpool=irlegacyop=NULL;
+	irmap=NULL;
+	irswitch=NULL;
+	FusedCount=NULL;
+#ifdef L9PRELOAD
+	preloads=0;
+#endif
+	if (file)
+	{
+#ifdef PREDECODE
+		irreset();
+#endif
+#ifdef AOTCODE
+		aotcheck();
+#endif
+	}
+	SetContext(old);
+	return clone;
+}
+
+/* the time now in seconds, for the load statistics */
+double loadclock(void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec/1e9;
+#else
+	return (double) clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+/* starts timing a phase of loading, returning when it started */
+double loadstart(void)
+{
+	loadmemory=0;
+	return booting ? loadclock() : 0;
+}
+
+/* adds the time since start, and the memory used, to the statistics of phase */
+void loadend(int phase,double start)
+{
+	if (!booting) return;
+	loadstats[phase].seconds+=loadclock()-start;
+	if (loadmemory>loadstats[phase].bytes) loadstats[phase].bytes=loadmemory;
+}
+
+/* notes how much memory the phase being timed has allocated at once */
+void loadmemoryused(L9UINT32 bytes)
+{
+	if (bytes>loadmemory) loadmemory=bytes;
+}
+
 L9BOOL load(char *filename)
 {
 	FILE *f=fopen(filename,"rb");
@@ -767,14 +1863,14 @@ L9BOOL load(char *filename)
 		return FALSE;
 	}
 
-	L9Allocate(&startfile,FileSize);
-	if (fread(startfile,1,FileSize,f)!=FileSize)
-	{
-		fclose(f);
-		return FALSE;
-	}
+	if (startfile) freefile(startfile,startfilemap);
+	startfile=readfile(f,FileSize,&startfilemap);
  	fclose(f);
-	return TRUE;
+#ifdef L9MMAP
+	startdirty();
+#endif
+	loadmemoryused(FileSize);
+	return startfile!=NULL;
 }
 
 L9UINT16 scanmovewa5d0(L9BYTE* Base,L9UINT32 *Pos)
@@ -845,174 +1941,234 @@ L9BOOL CheckCallDriverV4(L9BYTE* Base,L9UINT32 Pos)
 	return FALSE;
 }
 
-L9BOOL ValidateSequence(L9BYTE* Base,L9BYTE* Image,L9UINT32 iPos,L9UINT32 acode,L9UINT32 *Size,L9UINT32 FileSize,L9UINT32 *Min,L9UINT32 *Max,L9BOOL Rts,L9BOOL *JumpKill, L9BOOL *DriverV4)
+/* the code after a branch, waiting while the branch target is walked */
+typedef struct
+{
+	L9UINT32 iPos,Pos;
+	L9BOOL Rts,Finished;
+} ScanFrame;
+
+L9BOOL ValidateSequence(L9BYTE* Base,L9BYTE* Image,L9UINT32 iPos,L9UINT32 acode,L9UINT32 *Size,L9UINT32 DataSize,L9UINT32 *Min,L9UINT32 *Max,L9BOOL Rts,L9BOOL *JumpKill, L9BOOL *DriverV4)
 {
-	L9UINT32 Pos;
-	L9BOOL Finished=FALSE,Valid;
+	L9UINT32 Pos,Val=0;
+	L9BOOL Finished=FALSE,Valid=TRUE,Branch,BranchRts=FALSE;
 	L9UINT32 Strange=0;
 	int ScanCodeMask;
 	int Code;
+	ScanFrame *Stack=NULL,*Frame;
+	int Depth=0,StackSize=0;
 	*JumpKill=FALSE;
 
-	if (iPos>=FileSize)
+	if (iPos>=DataSize)
 		return FALSE;
 	Pos=iPos;
 	if (Pos<*Min) *Min=Pos;
 
-	if (Image[Pos]) return TRUE; /* hit valid code */
+	if (IMAGETEST(Image,Pos)) return TRUE; /* hit valid code */
 
-	do
+	/* Branch targets are walked before the code that follows the branch,
+	   in the same order as a recursive walk would take, but the code
+	   still to be walked is kept on Stack rather than the C stack. */
+	for (;;)
 	{
-		Code=Base[Pos];
-		Valid=TRUE;
-		if (Image[Pos]) break; /* converged to found code */
-		Image[Pos++]=2;
-		if (Pos>*Max) *Max=Pos;
-
-		ScanCodeMask=0x9f;
-		if (Code&0x80)
+		Branch=FALSE;
+		while (Valid && !Finished && !Branch && Pos<DataSize)
 		{
-			ScanCodeMask=0xff;
-			if ((Code&0x1f)>0xa)
-				Valid=FALSE;
-			Pos+=2;
-		}
-		else switch (Code & 0x1f)
-		{
-			case 0: /* goto */
+			Code=Base[Pos];
+			if (IMAGETEST(Image,Pos)) /* converged to found code */
 			{
-				L9UINT32 Val=scangetaddr(Code,Base,&Pos,acode,&ScanCodeMask);
-				Valid=ValidateSequence(Base,Image,Val,acode,Size,FileSize,Min,Max,TRUE/*Rts*/,JumpKill,DriverV4);
 				Finished=TRUE;
 				break;
 			}
-			case 1: /* intgosub */
+			IMAGEMARK(Image,Pos);
+			Pos++;
+			if (Pos>*Max) *Max=Pos;
+
+			ScanCodeMask=0x9f;
+			if (Code&0x80)
 			{
-				L9UINT32 Val=scangetaddr(Code,Base,&Pos,acode,&ScanCodeMask);
-				Valid=ValidateSequence(Base,Image,Val,acode,Size,FileSize,Min,Max,TRUE,JumpKill,DriverV4);
-				break;
+				ScanCodeMask=0xff;
+				if ((Code&0x1f)>0xa)
+					Valid=FALSE;
+				Pos+=2;
 			}
-			case 2: /* intreturn */
-				Valid=Rts;
-				Finished=TRUE;
-				break;
-			case 3: /* printnumber */
-				Pos++;
-				break;
-			case 4: /* messagev */
-				Pos++;
-				break;
-			case 5: /* messagec */
-				scangetcon(Code,&Pos,&ScanCodeMask);
-				break;
-			case 6: /* function */
-				switch (Base[Pos++])
-				{
-					case 2:/* random */
-						Pos++;
-						break;
-					case 1:/* calldriver */
-						if (DriverV4)
-						{
-							if (CheckCallDriverV4(Base,Pos-2))
-								*DriverV4 = TRUE;
-						}
-						break;
-					case 3:/* save */
-					case 4:/* restore */
-					case 5:/* clearworkspace */
-					case 6:/* clear stack */
-						break;
-					case 250: /* printstr */
-						while (Base[Pos++]);
-						break;
-
-					default:
+			else switch (Code & 0x1f)
+			{
+				case 0: /* goto */
+					Val=scangetaddr(Code,Base,&Pos,acode,&ScanCodeMask);
+					BranchRts=TRUE;
+					Branch=TRUE;
+					Finished=TRUE;
+					break;
+				case 1: /* intgosub */
+					Val=scangetaddr(Code,Base,&Pos,acode,&ScanCodeMask);
+					BranchRts=TRUE;
+					Branch=TRUE;
+					break;
+				case 2: /* intreturn */
+					Valid=Rts;
+					Finished=TRUE;
+					break;
+				case 3: /* printnumber */
+					Pos++;
+					break;
+				case 4: /* messagev */
+					Pos++;
+					break;
+				case 5: /* messagec */
+					scangetcon(Code,&Pos,&ScanCodeMask);
+					break;
+				case 6: /* function */
+					switch (Base[Pos++])
+					{
+						case 2:/* random */
+							Pos++;
+							break;
+						case 1:/* calldriver */
+							if (DriverV4)
+							{
+								if (CheckCallDriverV4(Base,Pos-2))
+									*DriverV4 = TRUE;
+							}
+							break;
+						case 3:/* save */
+						case 4:/* restore */
+						case 5:/* clearworkspace */
+						case 6:/* clear stack */
+							break;
+						case 250: /* printstr */
+							while (Base[Pos++]);
+							break;
+
+						default:
 #ifdef L9DEBUG
-						/* printf("scan: illegal function call: %d",Base[Pos-1]); */
+							/* printf("scan: illegal function call: %d",Base[Pos-1]); */
 #endif
-						Valid=FALSE;
-						break;
-				}
-				break;
-			case 7: /* input */
-				Pos+=4;
-				break;
-			case 8: /* varcon */
-				scangetcon(Code,&Pos,&ScanCodeMask);
-				Pos++;
-				break;
-			case 9: /* varvar */
-				Pos+=2;
-				break;
-			case 10: /* _add */
-				Pos+=2;
-				break;
-			case 11: /* _sub */
-				Pos+=2;
-				break;
-			case 14: /* jump */
+							Valid=FALSE;
+							break;
+					}
+					break;
+				case 7: /* input */
+					Pos+=4;
+					break;
+				case 8: /* varcon */
+					scangetcon(Code,&Pos,&ScanCodeMask);
+					Pos++;
+					break;
+				case 9: /* varvar */
+					Pos+=2;
+					break;
+				case 10: /* _add */
+					Pos+=2;
+					break;
+				case 11: /* _sub */
+					Pos+=2;
+					break;
+				case 14: /* jump */
 #ifdef L9DEBUG
-				/* printf("jmp at codestart: %ld",acode); */
+					/* printf("jmp at codestart: %ld",acode); */
 #endif
-				*JumpKill=TRUE;
-				Finished=TRUE;
-				break;
-			case 15: /* exit */
-				Pos+=4;
-				break;
-			case 16: /* ifeqvt */
-			case 17: /* ifnevt */
-			case 18: /* ifltvt */
-			case 19: /* ifgtvt */
+					*JumpKill=TRUE;
+					Finished=TRUE;
+					break;
+				case 15: /* exit */
+					Pos+=4;
+					break;
+				case 16: /* ifeqvt */
+				case 17: /* ifnevt */
+				case 18: /* ifltvt */
+				case 19: /* ifgtvt */
+					Pos+=2;
+					Val=scangetaddr(Code,Base,&Pos,acode,&ScanCodeMask);
+					BranchRts=Rts;
+					Branch=TRUE;
+					break;
+				case 20: /* screen */
+					if (Base[Pos++]) Pos++;
+					break;
+				case 21: /* cleartg */
+					Pos++;
+					break;
+				case 22: /* picture */
+					Pos++;
+					break;
+				case 23: /* getnextobject */
+					Pos+=6;
+					break;
+				case 24: /* ifeqct */
+				case 25: /* ifnect */
+				case 26: /* ifltct */
+				case 27: /* ifgtct */
+					Pos++;
+					scangetcon(Code,&Pos,&ScanCodeMask);
+					Val=scangetaddr(Code,Base,&Pos,acode,&ScanCodeMask);
+					BranchRts=Rts;
+					Branch=TRUE;
+					break;
+				case 28: /* printinput */
+					break;
+				case 12: /* ilins */
+				case 13: /* ilins */
+				case 29: /* ilins */
+				case 30: /* ilins */
+				case 31: /* ilins */
+#ifdef L9DEBUG 
+					/* printf("scan: illegal instruction"); */
+#endif
+					Valid=FALSE;
+					break;
+			}
+			if (Valid && (Code & ~ScanCodeMask))
+				Strange++;
+		}
+
+		if (Branch)
+		{
+			/* start walking the branch target, unless it is already known */
+			*JumpKill=FALSE;
+			if (Val>=DataSize)
 			{
-				L9UINT32 Val;
-				Pos+=2;
-				Val=scangetaddr(Code,Base,&Pos,acode,&ScanCodeMask);
-				Valid=ValidateSequence(Base,Image,Val,acode,Size,FileSize,Min,Max,Rts,JumpKill,DriverV4);
-				break;
+				Valid=FALSE;
+				continue;
 			}
-			case 20: /* screen */
-				if (Base[Pos++]) Pos++;
-				break;
-			case 21: /* cleartg */
-				Pos++;
-				break;
-			case 22: /* picture */
-				Pos++;
-				break;
-			case 23: /* getnextobject */
-				Pos+=6;
-				break;
-			case 24: /* ifeqct */
-			case 25: /* ifnect */
-			case 26: /* ifltct */
-			case 27: /* ifgtct */
+			if (Val<*Min) *Min=Val;
+			if (IMAGETEST(Image,Val))
+				continue;
+
+			if (Depth==StackSize)
 			{
-				L9UINT32 Val;
-				Pos++;
-				scangetcon(Code,&Pos,&ScanCodeMask);
-				Val=scangetaddr(Code,Base,&Pos,acode,&ScanCodeMask);
-				Valid=ValidateSequence(Base,Image,Val,acode,Size,FileSize,Min,Max,Rts,JumpKill,DriverV4);
-				break;
+				ScanFrame *NewStack;
+				StackSize=StackSize ? StackSize*2 : 64;
+				NewStack=realloc(Stack,StackSize*sizeof(ScanFrame));
+				if (NewStack==NULL)
+				{
+					free(Stack);
+					return FALSE;
+				}
+				Stack=NewStack;
 			}
-			case 28: /* printinput */
-				break;
-			case 12: /* ilins */
-			case 13: /* ilins */
-			case 29: /* ilins */
-			case 30: /* ilins */
-			case 31: /* ilins */
-#ifdef L9DEBUG 
-				/* printf("scan: illegal instruction"); */
-#endif
-				Valid=FALSE;
-				break;
+			Frame=Stack+Depth++;
+			Frame->iPos=iPos;
+			Frame->Pos=Pos;
+			Frame->Rts=Rts;
+			Frame->Finished=Finished;
+			iPos=Pos=Val;
+			Rts=BranchRts;
+			Finished=FALSE;
+			continue;
 		}
-	if (Valid && (Code & ~ScanCodeMask))
-		Strange++;
-	} while (Valid && !Finished && Pos<FileSize); /* && Strange==0); */
-	(*Size)+=Pos-iPos;
+
+		/* this sequence has ended: carry on after the branch that led here */
+		(*Size)+=Pos-iPos;
+		if (Depth==0)
+			break;
+		Frame=Stack+--Depth;
+		iPos=Frame->iPos;
+		Pos=Frame->Pos;
+		Rts=Frame->Rts;
+		Finished=Frame->Finished;
+	}
+	free(Stack);
 	return Valid; /* && Strange==0; */
 }
 
@@ -1023,178 +2179,624 @@ L9BYTE calcchecksum(L9BYTE* ptr,L9UINT32 num)
 	return d1;
 }
 
-/*
-L9BOOL Check(L9BYTE* StartFile,L9UINT32 FileSize,L9UINT32 Offset)
+/* clears the marks ValidateSequence() made in Image from Min to Max-1,
+   along with any others sharing their bytes */
+void scanclear(L9BYTE* Image,L9UINT32 Min,L9UINT32 Max)
 {
-	L9UINT16 d0,num;
-	int i;
-	L9BYTE* Image;
-	L9UINT32 Size=0,Min,Max;
-	L9BOOL ret,JumpKill;
+	if (Min<Max)
+		memset(Image+(Min>>3),0,IMAGESIZE(Max)-(Min>>3));
+}
 
-	for (i=0;i<12;i++)
+/* returns the sums of the bytes of the file up to each multiple of
+   CHKBLOCK, for scansum() */
+L9BYTE* scanchecksums(L9BYTE* StartFile,L9UINT32 DataSize)
+{
+	L9BYTE *Chk=malloc(DataSize/CHKBLOCK+1);
+	L9BYTE d1=0;
+	L9UINT32 i=0,k;
+
+	if (Chk==NULL) return NULL;
+	Chk[0]=0;
+	for (k=1;k<=DataSize/CHKBLOCK;k++)
 	{
-		d0=L9WORD (StartFile+Offset+0x12 + i*2);
-		if (d0>=0x8000+LISTAREASIZE) return FALSE;
+#if defined(SCANAVX2) || defined(SCANSSE2)
+		/* summed eight bytes at a time into the two halves of s */
+		__m128i s=_mm_setzero_si128();
+		int j;
+
+		for (j=0;j<CHKBLOCK;j+=16)
+			s=_mm_add_epi64(s,_mm_sad_epu8(_mm_loadu_si128((__m128i*) (StartFile+i+j)),_mm_setzero_si128()));
+		d1+=(L9BYTE) (_mm_cvtsi128_si32(s)+_mm_cvtsi128_si32(_mm_srli_si128(s,8)));
+		i+=CHKBLOCK;
+#else
+		L9UINT32 end=i+CHKBLOCK;
+
+		while (i<end) d1+=StartFile[i++];
+#endif
+		Chk[k]=d1;
+	}
+	return Chk;
+}
+
+/* returns the sum of the bytes of the file before offset i, working from
+   whichever of the sums in Chk is nearer */
+L9BYTE scansum(L9BYTE* StartFile,L9BYTE* Chk,L9UINT32 DataSize,L9UINT32 i)
+{
+	L9UINT32 j=i-i%CHKBLOCK;
+	L9BYTE d1;
+
+	if (i-j<=CHKBLOCK/2 || j+CHKBLOCK>DataSize)
+	{
+		d1=Chk[j/CHKBLOCK];
+		while (j<i) d1+=StartFile[j++];
+	}
+	else
+	{
+		j+=CHKBLOCK;
+		d1=Chk[j/CHKBLOCK];
+		while (j>i) d1-=StartFile[--j];
 	}
+	return d1;
+}
 
-	num=L9WORD(StartFile+Offset)+1;
-	if (Offset+num>FileSize) return FALSE;
-	if (calcchecksum(StartFile+Offset,num)) return FALSE; 
+/* notes how much scratch memory a scan has in use at once */
+void scanmemoryused(L9UINT32 bytes)
+{
+	if (bytes>scanmemory) scanmemory=bytes;
+	loadmemoryused(bytes);
+}
 
-	Image=calloc(FileSize,1);
+L9UINT32 GetScanMemory(void)
+{
+	return scanmemory;
+}
 
-	Min=Max=Offset+d0;
-	ret=ValidateSequence(StartFile,Image,Offset+d0,Offset+d0,&Size,FileSize,&Min,&Max,FALSE,&JumpKill,NULL);
-	free(Image);
-	return ret;
+/* L9cut's test for the start of V2 game data */
+L9BOOL knownV2header(L9BYTE* data)
+{
+	return data[4]==0x20 && data[5]==0x00 && data[10]==0x00 && data[11]==0x80
+		&& data[20]==data[22] && data[21]==data[23];
 }
-*/
 
-long Scan(L9BYTE* StartFile,L9UINT32 FileSize)
+/* the CRC L9cut works out, of num bytes followed by padding zero bytes */
+L9UINT16 calccrc(L9BYTE* ptr,L9UINT32 num,int padding)
 {
-	L9BYTE *Chk=malloc(FileSize+1);
-	L9BYTE *Image=calloc(FileSize,1);
-	L9UINT32 i,num,Size,MaxSize=0;
-	int j;
-	L9UINT16 d0=0,l9,md,ml,dd,dl;
-	L9UINT32 Min,Max;
-	long Offset=-1;
-	L9BOOL JumpKill, DriverV4;
+	L9UINT16 table[256],crc;
+	int i,bit;
 
-	if ((Chk==NULL)||(Image==NULL))
+	for (i=0;i<256;i++)
 	{
-		fprintf(stderr,"Unable to allocate memory for game scan! Exiting...\n");
-		exit(0);
+		crc=i;
+		for (bit=0;bit<8;bit++)
+			crc=crc&1 ? 0xa001^(crc>>1) : crc>>1;
+		table[i]=crc;
 	}
+	crc=0;
+	while (num--!=0) crc=table[(crc^*ptr++)&0xff]^(crc>>8);
+	while (padding--!=0) crc=table[crc&0xff]^(crc>>8);
+	return crc;
+}
 
-	Chk[0]=0;
-	for (i=1;i<=FileSize;i++)
-		Chk[i]=Chk[i-1]+StartFile[i-1];
+/* looks up the game whose data starts at data in L9KnownGames, allowing for
+   patched versions, and if guess is TRUE settling for a game with the same
+   length and checksum; returns NULL if there is none */
+struct L9KnownGame* findknowngame(L9BYTE* data,L9UINT32 size,L9BOOL guess)
+{
+	struct L9KnownGame* game;
+	struct L9GamePatch* patch;
+	L9UINT16 length,crc,origcrc;
+	L9BYTE checksum,origchecksum;
+	L9BOOL V2;
+
+	if (size<30) return NULL;
+
+	/* as L9cut finds the length and checksum */
+	V2=knownV2header(data);
+	length=V2 ? L9WORD(data+28) : L9WORD(data);
+	if (length>=size) return NULL;
+	checksum=V2 ? calcchecksum(data,length+1) : data[length];
 
-	for (i=0;i<FileSize-33;i++)
+	/* only work out the CRC if some game could match */
+	for (game=L9KnownGames;game->length;game++)
 	{
-		num=L9WORD(StartFile+i)+1;
+		if (game->length==length && game->checksum==checksum) break;
+	}
+	for (patch=L9GamePatches;patch->length;patch++)
+	{
+		if (patch->length==length && patch->patchchecksum==checksum) break;
+	}
+	if (!game->length && !patch->length) return NULL;
+
+	/* L9cut pads the data with two zero bytes */
+	crc=calccrc(data,length+1,2);
+	origchecksum=checksum;
+	origcrc=crc;
+	for (patch=L9GamePatches;patch->length;patch++)
+	{
+		if (patch->length==length && patch->patchchecksum==checksum && patch->patchcrc==crc)
+		{
+			origchecksum=patch->origchecksum;
+			origcrc=patch->origcrc;
+			break;
+		}
+	}
+
+	for (game=L9KnownGames;game->length;game++)
+	{
+		if (game->length==length && game->checksum==origchecksum && game->crc==origcrc)
+			return game;
+	}
+	if (guess)
+	{
+		for (game=L9KnownGames;game->length;game++)
+		{
+			if (game->length==length && game->checksum==checksum)
+				return game;
+		}
+	}
+	return NULL;
+}
+
+/* the name of the bound game, or NULL if it is not a known game */
+const char* GetGameName(void)
+{
+	struct L9KnownGame* game;
+
+	if (startdata==NULL) return NULL;
+	game=findknowngame(startdata,FileSize,TRUE);
+	return game ? game->name : NULL;
+}
+
 /*
-		Chk[i] = 0 +...+ i-1
-		Chk[i+n] = 0 +...+ i+n-1
-		Chk[i+n] - Chk[i] = i + ... + i+n
+L9BOOL Check(L9BYTE* StartFile,L9UINT32 DataSize,L9UINT32 Offset)
+{
+	L9UINT16 d0,num;
+	int i;
+	L9BYTE* Image;
+	L9UINT32 Size=0,Min,Max;
+	L9BOOL ret,JumpKill;
+
+	for (i=0;i<12;i++)
+	{
+		d0=L9WORD (StartFile+Offset+0x12 + i*2);
+		if (d0>=0x8000+LISTAREASIZE) return FALSE;
+	}
+
+	num=L9WORD(StartFile+Offset)+1;
+	if (Offset+num>DataSize) return FALSE;
+	if (calcchecksum(StartFile+Offset,num)) return FALSE; 
+
+	Image=calloc(DataSize,1);
+
+	Min=Max=Offset+d0;
+	ret=ValidateSequence(StartFile,Image,Offset+d0,Offset+d0,&Size,DataSize,&Min,&Max,FALSE,&JumpKill,NULL);
+	free(Image);
+	return ret;
+}
 */
-		if (num>0x2000 && i+num<=FileSize && Chk[i+num]==Chk[i])
+
+/* checks the V3 or V4 header at offset i, whose checksum is right, and the
+   code it points to, adding the size of the code to Size */
+L9BOOL ScanHeaderV3(L9BYTE* StartFile,L9BYTE* Image,L9UINT32 i,L9UINT32 DataSize,L9UINT32 *Size,L9BOOL *DriverV4)
+{
+	int j;
+	L9UINT16 d0=0,l9,md,ml,dd,dl;
+	L9UINT32 Min,Max;
+	L9BOOL JumpKill,Valid;
+
+	md=L9WORD(StartFile+i+0x2);
+	ml=L9WORD(StartFile+i+0x4);
+	dd=L9WORD(StartFile+i+0xa);
+	dl=L9WORD(StartFile+i+0xc);
+
+	if (!(ml>0 && md>0 && i+md+ml<=DataSize && dd>0 && dl>0 && i+dd+dl*4<=DataSize))
+		return FALSE;
+
+	/* v4 files may have acodeptr in 8000-9000, need to fix */
+	for (j=0;j<12;j++)
+	{
+		d0=L9WORD (StartFile+i+0x12 + j*2);
+		if (j!=11 && d0>=0x8000 && d0<0x9000)
+		{
+			if (d0>=0x8000+LISTAREASIZE) break;
+		}
+		else if (i+d0>DataSize) break;
+	}
+	/* list9 ptr must be in listarea, acode ptr in data */
+	if (j<12 /*|| (d0>=0x8000 && d0<0x9000)*/) return FALSE;
+
+	l9=L9WORD(StartFile+i+0x12 + 10*2);
+	if (l9<0x8000 || l9>=0x8000+LISTAREASIZE) return FALSE;
+
+	Min=Max=i+d0;
+	Valid=ValidateSequence(StartFile,Image,i+d0,i+d0,Size,DataSize,&Min,&Max,FALSE,&JumpKill,DriverV4);
+	/* leave Image clear, so that each header is judged on its code alone */
+	scanclear(Image,Min,Max);
+	return Valid;
+}
+
+/* checks the V2 header at offset i, whose checksum is right, and the code
+   it points to, adding the size of the code to Size */
+L9BOOL ScanHeaderV2(L9BYTE* StartFile,L9BYTE* Image,L9UINT32 i,L9UINT32 DataSize,L9UINT32 *Size)
+{
+	int j;
+	L9UINT16 d0=0,l9;
+	L9UINT32 Min,Max;
+	L9BOOL JumpKill,Valid;
+
+	for (j=0;j<14;j++)
+	{
+		 d0=L9WORD (StartFile+i+ j*2);
+		 if (j!=13 && d0>=0x8000 && d0<0x9000)
+		 {
+			if (d0>=0x8000+LISTAREASIZE) break;
+		 }
+		 else if (i+d0>DataSize) break;
+	}
+	/* list9 ptr must be in listarea, acode ptr in data */
+	if (j<14 /*|| (d0>=0x8000 && d0<0x9000)*/) return FALSE;
+
+	l9=L9WORD(StartFile+i+6 + 9*2);
+	if (l9<0x8000 || l9>=0x8000+LISTAREASIZE) return FALSE;
+
+	Min=Max=i+d0;
+	Valid=ValidateSequence(StartFile,Image,i+d0,i+d0,Size,DataSize,&Min,&Max,FALSE,&JumpKill,NULL);
+	/* leave Image clear, so that each header is judged on its code alone */
+	scanclear(Image,Min,Max);
+	return Valid;
+}
+
+#if defined(SCANAVX2) || defined(SCANSSE2)
+/* the position of the lowest bit set in a mask of offsets, found from the
+   top five bits of that bit times a de Bruijn sequence */
+const L9BYTE scanbit[32]={0,1,28,2,29,14,24,3,30,22,20,15,25,17,4,8,
+	31,27,13,23,21,19,16,7,26,12,18,6,11,5,10,9};
+#define LOWESTBIT(m) scanbit[((((m)&-(m))*0x077CB531UL)&0xffffffffUL)>>27]
+#endif
+
+/* picks out the offsets from From to To-1 that could hold a header, from
+   the high byte of the list 9 pointer at l9, which must be in the list
+   area, and for V3 and V4 headers of the length, which must be at least
+   0x2000; stores them in list and returns how many there are */
+int scancandidates(L9BYTE* StartFile,L9UINT32 DataSize,L9UINT32 From,L9UINT32 To,int l9,L9BOOL V3,L9UINT32* list)
+{
+	L9UINT32 i=From;
+	int n=0;
+	L9BYTE h;
+
+	/* a header must lie wholly within the data */
+	if (To+l9+1>DataSize)
+		To=DataSize>(L9UINT32) (l9+1) ? DataSize-l9-1 : 0;
+#if defined(SCANAVX2) || defined(SCANSSE2)
+	{
+#ifdef SCANAVX2
+#define SCANLANES 32
+		const __m256i area=_mm256_set1_epi8((char) 0x80),last=_mm256_set1_epi8((LISTAREASIZE>>8)-1);
+		const __m256i least=_mm256_set1_epi8(0x20),all=_mm256_set1_epi8((char) 0xff);
+		__m256i x,d,ok;
+		L9UINT32 mask;
+#else
+#define SCANLANES 16
+		const __m128i area=_mm_set1_epi8((char) 0x80),last=_mm_set1_epi8((LISTAREASIZE>>8)-1);
+		const __m128i least=_mm_set1_epi8(0x20),all=_mm_set1_epi8((char) 0xff);
+		__m128i x,d,ok;
+		L9UINT32 mask;
+#endif
+		for (;i+SCANLANES<=To;i+=SCANLANES)
 		{
-			md=L9WORD(StartFile+i+0x2);
-			ml=L9WORD(StartFile+i+0x4);
-			dd=L9WORD(StartFile+i+0xa);
-			dl=L9WORD(StartFile+i+0xc);
+#ifdef SCANAVX2
+			x=_mm256_loadu_si256((__m256i*) (StartFile+i+l9+1));
+			d=_mm256_sub_epi8(x,area);
+			ok=_mm256_cmpeq_epi8(_mm256_min_epu8(d,last),d);
+			x=_mm256_loadu_si256((__m256i*) (StartFile+i+1));
+			ok=_mm256_and_si256(ok,V3 ? _mm256_cmpeq_epi8(_mm256_max_epu8(x,least),x) : all);
+			mask=(unsigned int) _mm256_movemask_epi8(ok);
+#else
+			x=_mm_loadu_si128((__m128i*) (StartFile+i+l9+1));
+			d=_mm_sub_epi8(x,area);
+			ok=_mm_cmpeq_epi8(_mm_min_epu8(d,last),d);
+			x=_mm_loadu_si128((__m128i*) (StartFile+i+1));
+			ok=_mm_and_si128(ok,V3 ? _mm_cmpeq_epi8(_mm_max_epu8(x,least),x) : all);
+			mask=(unsigned int) _mm_movemask_epi8(ok);
+#endif
+			for (;mask;mask&=mask-1)
+				list[n++]=i+LOWESTBIT(mask);
+		}
+	}
+#elif defined(SCANNEON)
+	{
+		const uint8x16_t area=vdupq_n_u8(0x80),last=vdupq_n_u8((LISTAREASIZE>>8)-1);
+		const uint8x16_t least=vdupq_n_u8(V3 ? 0x20 : 0);
+		L9BYTE ok[16];
+		uint8x16_t m;
+		int b;
 
-			if (ml>0 && md>0 && i+md+ml<=FileSize && dd>0 && dl>0 && i+dd+dl*4<=FileSize)
+		for (;i+16<=To;i+=16)
+		{
+			m=vcleq_u8(vsubq_u8(vld1q_u8(StartFile+i+l9+1),area),last);
+			m=vandq_u8(m,vcgeq_u8(vld1q_u8(StartFile+i+1),least));
+			if ((vgetq_lane_u64(vreinterpretq_u64_u8(m),0)|vgetq_lane_u64(vreinterpretq_u64_u8(m),1))==0)
+				continue;
+			vst1q_u8(ok,m);
+			for (b=0;b<16;b++)
 			{
-				/* v4 files may have acodeptr in 8000-9000, need to fix */
-				for (j=0;j<12;j++)
-				{
-					d0=L9WORD (StartFile+i+0x12 + j*2);
-					if (j!=11 && d0>=0x8000 && d0<0x9000)
-					{
-						if (d0>=0x8000+LISTAREASIZE) break;
-					}
-					else if (i+d0>FileSize) break;
-				}
-				/* list9 ptr must be in listarea, acode ptr in data */
-				if (j<12 /*|| (d0>=0x8000 && d0<0x9000)*/) continue;
+				if (ok[b]) list[n++]=i+b;
+			}
+		}
+	}
+#endif
+	for (;i<To;i++)
+	{
+		h=StartFile[i+l9+1];
+		if (h>=0x80 && h<0x80+(LISTAREASIZE>>8) && (!V3 || StartFile[i+1]>=0x20))
+			list[n++]=i;
+	}
+	return n;
+}
 
-				l9=L9WORD(StartFile+i+0x12 + 10*2);
-				if (l9<0x8000 || l9>=0x8000+LISTAREASIZE) continue;
+/* a range of offsets for Scan() or ScanV2() to look for headers in, and
+   the best header found there */
+typedef struct
+{
+	L9BYTE *StartFile,*Chk;
+	L9UINT32 DataSize,From,To;
+	long Offset;
+	L9UINT32 MaxSize;
+	L9BOOL DriverV4;
+	L9UINT32 Memory;	/* scratch memory used */
+	L9BOOL Failed;	/* there was not the memory to look */
+} ScanPart;
+
+void* ScanPartV3(void* arg)
+{
+	ScanPart *p=(ScanPart*) arg;
+	L9BYTE *StartFile=p->StartFile,*Chk=p->Chk;
+	L9BYTE *Image=calloc(IMAGESIZE(p->DataSize),1);
+	L9UINT32 *list=malloc(SCANBLOCK*sizeof(L9UINT32));
+	L9UINT32 i,num,Size,DataSize=p->DataSize,From;
+	L9BOOL DriverV4;
+	int c,n;
+
+	if ((Image==NULL)||(list==NULL))
+	{
+		free(list);
+		free(Image);
+		p->Failed=TRUE;
+		return NULL;
+	}
+	p->Memory=IMAGESIZE(DataSize)+SCANBLOCK*sizeof(L9UINT32);
 
+	for (From=p->From;From<p->To;From+=SCANBLOCK)
+	{
+		n=scancandidates(StartFile,DataSize,From,From+SCANBLOCK<p->To ? From+SCANBLOCK : p->To,0x26,TRUE,list);
+		for (c=0;c<n;c++)
+		{
+			i=list[c];
+			num=L9WORD(StartFile+i)+1;
+			/* the data from the header on sums to zero */
+			if (num>0x2000 && i+num<=DataSize
+				&& scansum(StartFile,Chk,DataSize,i+num)==scansum(StartFile,Chk,DataSize,i))
+			{
 				Size=0;
-				Min=Max=i+d0;
 				DriverV4=0;
-				if (ValidateSequence(StartFile,Image,i+d0,i+d0,&Size,FileSize,&Min,&Max,FALSE,&JumpKill,&DriverV4))
+				if (ScanHeaderV3(StartFile,Image,i,DataSize,&Size,&DriverV4))
 				{
 #ifdef L9DEBUG
 					printf("Found valid header at %ld, code size %ld",i,Size);
 #endif
-					if (Size>MaxSize && Size>100)
+					if (Size>p->MaxSize && Size>100)
 					{
-						Offset=i;
-						MaxSize=Size;
-						L9GameType=DriverV4?L9_V4:L9_V3;
+						p->Offset=i;
+						p->MaxSize=Size;
+						p->DriverV4=DriverV4;
 					}
 				}
 			}
 		}
 	}
-	free(Chk);
+	free(list);
 	free(Image);
-	return Offset;
+	return NULL;
 }
 
-long ScanV2(L9BYTE* StartFile,L9UINT32 FileSize)
+void* ScanPartV2(void* arg)
 {
-	L9BYTE *Chk=malloc(FileSize+1);
-	L9BYTE *Image=calloc(FileSize,1);
-	L9UINT32 i,Size,MaxSize=0,num;
-	int j;
-	L9UINT16 d0=0,l9;
-	L9UINT32 Min,Max;
-	long Offset=-1;
-	L9BOOL JumpKill;
+	ScanPart *p=(ScanPart*) arg;
+	L9BYTE *StartFile=p->StartFile,*Chk=p->Chk;
+	L9BYTE *Image=calloc(IMAGESIZE(p->DataSize),1);
+	L9UINT32 *list=malloc(SCANBLOCK*sizeof(L9UINT32));
+	L9UINT32 i,num,Size,DataSize=p->DataSize,From;
+	int c,n;
 
-	if ((Chk==NULL)||(Image==NULL))
+	if ((Image==NULL)||(list==NULL))
 	{
-		fprintf(stderr,"Unable to allocate memory for game scan! Exiting...\n");
-		exit(0);
+		free(list);
+		free(Image);
+		p->Failed=TRUE;
+		return NULL;
 	}
+	p->Memory=IMAGESIZE(DataSize)+SCANBLOCK*sizeof(L9UINT32);
 
-	Chk[0]=0;
-	for (i=1;i<=FileSize;i++)
-		Chk[i]=Chk[i-1]+StartFile[i-1];
-
-	for (i=0;i<FileSize-28;i++)
+	for (From=p->From;From<p->To;From+=SCANBLOCK)
 	{
-		num=L9WORD(StartFile+i+28)+1;
-		if (i+num<=FileSize && ((Chk[i+num]-Chk[i+32])&0xff)==StartFile[i+0x1e])
+		n=scancandidates(StartFile,DataSize,From,From+SCANBLOCK<p->To ? From+SCANBLOCK : p->To,0x18,FALSE,list);
+		for (c=0;c<n;c++)
 		{
-			for (j=0;j<14;j++)
-			{
-				 d0=L9WORD (StartFile+i+ j*2);
-				 if (j!=13 && d0>=0x8000 && d0<0x9000)
-				 {
-					if (d0>=0x8000+LISTAREASIZE) break;
-				 }
-				 else if (i+d0>FileSize) break;
-			}
-			/* list9 ptr must be in listarea, acode ptr in data */
-			if (j<14 /*|| (d0>=0x8000 && d0<0x9000)*/) continue;
-
-			l9=L9WORD(StartFile+i+6 + 9*2);
-			if (l9<0x8000 || l9>=0x8000+LISTAREASIZE) continue;
-
-			Size=0;
-			Min=Max=i+d0;
-			if (ValidateSequence(StartFile,Image,i+d0,i+d0,&Size,FileSize,&Min,&Max,FALSE,&JumpKill,NULL))
+			i=list[c];
+			num=L9WORD(StartFile+i+28)+1;
+			if (i+num<=DataSize && (L9BYTE) (scansum(StartFile,Chk,DataSize,i+num)
+				-scansum(StartFile,Chk,DataSize,i+32))==StartFile[i+0x1e])
 			{
+				Size=0;
+				if (ScanHeaderV2(StartFile,Image,i,DataSize,&Size))
+				{
 #ifdef L9DEBUG 
-				printf("Found valid V2 header at %ld, code size %ld",i,Size);
+					printf("Found valid V2 header at %ld, code size %ld",i,Size);
 #endif
-				if (Size>MaxSize && Size>100)
-				{
-					Offset=i;
-					MaxSize=Size;
+					if (Size>p->MaxSize && Size>100)
+					{
+						p->Offset=i;
+						p->MaxSize=Size;
+					}
 				}
 			}
 		}
 	}
+	free(list);
+	free(Image);
+	return NULL;
+}
+
+/* runs scanpart over offsets 0 to End-1, split between threads when the
+   file is big enough, and returns the offset of the header with the most
+   code, the first one if several have as much, or -1 if there is none or
+   not the memory to look for one */
+long ScanParts(void* (*scanpart)(void*),L9BYTE* StartFile,L9UINT32 DataSize,L9UINT32 End,L9BOOL* DriverV4,L9UINT32* Size)
+{
+	L9BYTE *Chk=scanchecksums(StartFile,DataSize);
+	ScanPart part[SCANTHREADS];
+	L9UINT32 MaxSize=0,Memory=DataSize/CHKBLOCK+1;
+	long Offset=-1;
+	int n=1,k;
+#ifdef L9THREADS
+	pthread_t thread[SCANTHREADS];
+	L9BOOL started[SCANTHREADS];
+	long cpus=sysconf(_SC_NPROCESSORS_ONLN);
+
+	n=End/SCANPARTSIZE;
+	if (n>cpus) n=cpus;
+	if (n>SCANTHREADS) n=SCANTHREADS;
+	if (n<1) n=1;
+#endif
+
+	if (Chk==NULL) return -1;
+
+	for (k=0;k<n;k++)
+	{
+		part[k].StartFile=StartFile;
+		part[k].Chk=Chk;
+		part[k].DataSize=DataSize;
+		part[k].From=(L9UINT32) ((double) End*k/n);
+		part[k].To=(L9UINT32) ((double) End*(k+1)/n);
+		part[k].Offset=-1;
+		part[k].MaxSize=0;
+		part[k].DriverV4=FALSE;
+		part[k].Memory=0;
+		part[k].Failed=FALSE;
+	}
+#ifdef L9THREADS
+	/* this thread does the first part itself */
+	for (k=1;k<n;k++)
+		started[k]=pthread_create(&thread[k],NULL,scanpart,&part[k])==0;
+	scanpart(&part[0]);
+	for (k=1;k<n;k++)
+	{
+		if (started[k])
+			pthread_join(thread[k],NULL);
+		else
+			scanpart(&part[k]);
+	}
+#else
+	scanpart(&part[0]);
+#endif
+
+	for (k=0;k<n;k++)
+	{
+		Memory+=part[k].Memory;
+		if (part[k].MaxSize>MaxSize)
+		{
+			Offset=part[k].Offset;
+			MaxSize=part[k].MaxSize;
+			if (DriverV4) *DriverV4=part[k].DriverV4;
+		}
+	}
+	scanmemoryused(Memory);
 	free(Chk);
+	/* a part not looked at might have held a better header */
+	for (k=0;k<n;k++)
+	{
+		if (part[k].Failed)
+		{
+			Offset=-1;
+			MaxSize=0;
+		}
+	}
+	if (Size) *Size=MaxSize;
+	return Offset;
+}
+
+long Scan(L9BYTE* StartFile,L9UINT32 DataSize)
+{
+	L9BOOL DriverV4;
+	long Offset=ScanParts(ScanPartV3,StartFile,DataSize,DataSize-33,&DriverV4,NULL);
+
+	if (Offset>=0)
+		L9GameType=DriverV4?L9_V4:L9_V3;
+	return Offset;
+}
+
+long ScanV2(L9BYTE* StartFile,L9UINT32 DataSize)
+{
+	return ScanParts(ScanPartV2,StartFile,DataSize,DataSize-28,NULL,NULL);
+}
+
+/* looks for the data of a game in L9KnownGames, at the start of the file
+   and then anywhere in it, and checks only the header found there, which is
+   much quicker than Scan() and ScanV2(); returns the offset or -1 */
+long ScanKnown(L9BYTE* StartFile,L9UINT32 DataSize)
+{
+	L9BYTE *Chk,*Image;
+	L9UINT32 i,num,Size=0;
+	long Offset=-1;
+	L9BOOL V2,DriverV4=FALSE;
+
+	if (DataSize<34) return -1;
+	if (findknowngame(StartFile,DataSize,FALSE))
+		Offset=0;
+	else
+	{
+		Chk=scanchecksums(StartFile,DataSize);
+		if (Chk==NULL) return -1;
+		scanmemoryused(DataSize/CHKBLOCK+1);
+
+		for (i=1;i<DataSize-33 && Offset<0;i++)
+		{
+			/* V3 and V4 data sums to zero, as in Scan() */
+			if (!knownV2header(StartFile+i))
+			{
+				num=L9WORD(StartFile+i)+1;
+				if (i+num>DataSize || scansum(StartFile,Chk,DataSize,i+num)!=scansum(StartFile,Chk,DataSize,i))
+					continue;
+			}
+			if (findknowngame(StartFile+i,DataSize-i,FALSE))
+				Offset=i;
+		}
+		free(Chk);
+		if (Offset<0) return -1;
+	}
+
+	Image=calloc(IMAGESIZE(DataSize),1);
+	if (Image==NULL) return -1;
+	scanmemoryused(IMAGESIZE(DataSize));
+	V2=knownV2header(StartFile+Offset);
+	if ((V2 ? ScanHeaderV2(StartFile,Image,Offset,DataSize,&Size)
+		: ScanHeaderV3(StartFile,Image,Offset,DataSize,&Size,&DriverV4)) && Size>100)
+	{
+#ifdef L9DEBUG
+		printf("Found known game at %ld, code size %ld",Offset,Size);
+#endif
+		L9GameType=V2 ? L9_V2 : (DriverV4 ? L9_V4 : L9_V3);
+	}
+	else
+		Offset=-1;
 	free(Image);
 	return Offset;
 }
 
-long ScanV1(L9BYTE* StartFile,L9UINT32 FileSize)
+long ScanV1(L9BYTE* StartFile,L9UINT32 DataSize)
 {
-	L9BYTE *Image=calloc(FileSize,1);
+	L9BYTE *Image=calloc(IMAGESIZE(DataSize),1);
 	L9UINT32 i,Size;
-	int Replace;
-	L9BYTE* ImagePtr;
 	long MaxPos=-1;
 	L9UINT32 MaxCount=0;
 	L9UINT32 Min,Max,MaxMin,MaxMax;
@@ -1203,20 +2805,16 @@ long ScanV1(L9BYTE* StartFile,L9UINT32 FileSize)
 	int dictOff1, dictOff2;
 	L9BYTE dictVal1 = 0xff, dictVal2 = 0xff;
 
-	if (Image==NULL)
-	{
-		fprintf(stderr,"Unable to allocate memory for game scan! Exiting...\n");
-		exit(0);
-	}
+	if (Image==NULL) return -1;
+	scanmemoryused(IMAGESIZE(DataSize));
 
-	for (i=0;i<FileSize;i++)
+	for (i=0;i<DataSize;i++)
 	{
 		if ((StartFile[i]==0 && StartFile[i+1]==6) || (StartFile[i]==32 && StartFile[i+1]==4))
 		{
 			Size=0;
 			Min=Max=i;
-			Replace=0;
-			if (ValidateSequence(StartFile,Image,i,i,&Size,FileSize,&Min,&Max,FALSE,&JumpKill,NULL))
+			if (ValidateSequence(StartFile,Image,i,i,&Size,DataSize,&Min,&Max,FALSE,&JumpKill,NULL))
 			{
 				if (Size>MaxCount && Size>100 && Size<10000)
 				{
@@ -1227,13 +2825,8 @@ long ScanV1(L9BYTE* StartFile,L9UINT32 FileSize)
 					MaxPos=i;
 					MaxJK=JumpKill;
 				}
-				Replace=0;
-			}
-			for (ImagePtr=Image+Min;ImagePtr<=Image+Max;ImagePtr++)
-			{
-				if (*ImagePtr==2)
-					*ImagePtr=Replace;
 			}
+			scanclear(Image,Min,Max);
 		}
 	}
 #ifdef L9DEBUG
@@ -1241,7 +2834,7 @@ long ScanV1(L9BYTE* StartFile,L9UINT32 FileSize)
 #endif
 
 	/* V1 dictionary detection from L9Cut by Paul David Doherty */
-	for (i=0;i<FileSize-20;i++)
+	for (i=0;i<DataSize-20;i++)
 	{
 		if (StartFile[i]=='A')
 		{
@@ -1253,7 +2846,7 @@ long ScanV1(L9BYTE* StartFile,L9UINT32 FileSize)
 			}
 		}
 	}
-	for (i=dictOff1;i<FileSize-20;i++)
+	for (i=dictOff1;i<DataSize-20;i++)
 	{
 		if (StartFile[i]=='B')
 		{
@@ -1294,23 +2887,20 @@ long ScanV1(L9BYTE* StartFile,L9UINT32 FileSize)
 }
 
 #ifdef FULLSCAN
-void FullScan(L9BYTE* StartFile,L9UINT32 FileSize)
+void FullScan(L9BYTE* StartFile,L9UINT32 DataSize)
 {
-	L9BYTE *Image=calloc(FileSize,1);
+	L9BYTE *Image=calloc(IMAGESIZE(DataSize),1);
 	L9UINT32 i,Size;
-	int Replace;
-	L9BYTE* ImagePtr;
 	L9UINT32 MaxPos=0;
 	L9UINT32 MaxCount=0;
 	L9UINT32 Min,Max,MaxMin,MaxMax;
 	int Offset;
 	L9BOOL JumpKill,MaxJK;
-	for (i=0;i<FileSize;i++)
+	for (i=0;i<DataSize;i++)
 	{
 		Size=0;
 		Min=Max=i;
-		Replace=0;
-		if (ValidateSequence(StartFile,Image,i,i,&Size,FileSize,&Min,&Max,FALSE,&JumpKill,NULL))
+		if (ValidateSequence(StartFile,Image,i,i,&Size,DataSize,&Min,&Max,FALSE,&JumpKill,NULL))
 		{
 			if (Size>MaxCount)
 			{
@@ -1321,18 +2911,13 @@ void FullScan(L9BYTE* StartFile,L9UINT32 FileSize)
 				MaxPos=i;
 				MaxJK=JumpKill;
 			}
-			Replace=0;
-		}
-		for (ImagePtr=Image+Min;ImagePtr<=Image+Max;ImagePtr++)
-		{
-			if (*ImagePtr==2)
-				*ImagePtr=Replace;
 		}
+		scanclear(Image,Min,Max);
 	}
 	printf("%ld %ld %ld %ld %s",MaxPos,MaxCount,MaxMin,MaxMax,MaxJK ? "jmp killed" : "");
 	/* search for reference to MaxPos */
 	Offset=0x12 + 11*2;
-	for (i=0;i<FileSize-Offset-1;i++)
+	for (i=0;i<DataSize-Offset-1;i++)
 	{
 		if ((L9WORD(StartFile+i+Offset)) +i==MaxPos)
 		{
@@ -1341,7 +2926,7 @@ void FullScan(L9BYTE* StartFile,L9UINT32 FileSize)
 		}
 	}
 	Offset=13*2;
-	for (i=0;i<FileSize-Offset-1;i++)
+	for (i=0;i<DataSize-Offset-1;i++)
 	{
 		if ((L9WORD(StartFile+i+Offset)) +i==MaxPos)
 			printf("possible v2 Code reference at : %ld",i);
@@ -1350,12 +2935,20 @@ void FullScan(L9BYTE* StartFile,L9UINT32 FileSize)
 }
 #endif
 
+/* findsubs() keeps the number of subroutines found to follow each offset
+   it walks in a ring of this many entries; the offsets it needs at once,
+   of up to 11 subroutines of up to 0x3ff bytes, never span as many */
+#define SUBMEMO 0x4000
+
 L9BOOL findsubs(L9BYTE* testptr, L9UINT32 testsize, L9BYTE** picdata, L9UINT32 *picsize)
 {
-	int i, j, length, count;
+	int i, j, length, count, n, path[11];
 	L9BYTE *picptr, *startptr, *tmpptr;
+	L9UINT32 *memo, m;
 
 	if (testsize < 16) return FALSE;
+	memo = calloc(SUBMEMO, sizeof(L9UINT32));
+	if (memo) loadmemoryused(SUBMEMO*sizeof(L9UINT32));
 	
 	/*
 		Try to traverse the graphics subroutines.
@@ -1371,16 +2964,65 @@ L9BOOL findsubs(L9BYTE* testptr, L9UINT32 testsize, L9BYTE** picdata, L9UINT32 *
 		(pattern: 0xff | nn | nl | ll) and then tries to find the
 		first and next subroutines by evaluating the length fields
 		of the subroutine headers.
+
+		The headers that follow one are the same wherever the search
+		starts, so the number found is kept for each header passed, and
+		no chain is followed twice unless it is long enough to be used.
 	*/
 	for (i = 4; i < (int)(testsize - 4); i++)
 	{
+		/* go straight to the next 0xff */
+		if (testptr[i - 1] != 0xff)
+		{
+			if (i + 1 >= (int)(testsize - 4))
+				break;
+			tmpptr = memchr(testptr + i, 0xff, testsize - 5 - i);
+			if (tmpptr == NULL)
+				break;
+			i = tmpptr - testptr + 1;
+		}
+
 		picptr = testptr + i;
-		if (*(picptr - 1) != 0xff || (*picptr & 0x80) || (*(picptr + 1) & 0x0c) || (*(picptr + 2) < 4))
+		if ((*picptr & 0x80) || (*(picptr + 1) & 0x0c) || (*(picptr + 2) < 4))
 			continue;
 
 		count = 0;
-		startptr = picptr;
+		n = 0;
+		while (count <= 10)
+		{
+			/* each slot holds the offset of the header it counts for */
+			if (memo && ((m = memo[(picptr - testptr) & (SUBMEMO - 1)]) >> 4) == (L9UINT32) (picptr - testptr))
+			{
+				count += m & 15;
+				break;
+			}
+			path[n++] = picptr - testptr;
+
+			length = ((*(picptr + 1) & 0x0f) << 8) + *(picptr + 2);
+			if (length > 0x3ff || picptr + length + 4 > testptr + testsize)
+				break;
+			
+			picptr += length;
+			if (*(picptr - 1) != 0xff)
+				break;
+			if ((*picptr & 0x80) || (*(picptr + 1) & 0x0c) || (*(picptr + 2) < 4))
+				break;
+			
+			count++;
+		}
+		if (count <= 10)
+		{
+			if (memo)
+			{
+				for (j = 0; j < n; j++)
+					memo[path[j] & (SUBMEMO - 1)] = (path[j] << 4) | (count - j);
+			}
+			continue;
+		}
 
+		/* long enough, so follow it to the end */
+		picptr = testptr + i;
+		startptr = picptr;
 		while (TRUE)
 		{			
 			length = ((*(picptr + 1) & 0x0f) << 8) + *(picptr + 2);
@@ -1395,80 +3037,417 @@ L9BOOL findsubs(L9BYTE* testptr, L9UINT32 testsize, L9BYTE** picdata, L9UINT32 *
 			}
 			if ((*picptr & 0x80) || (*(picptr + 1) & 0x0c) || (*(picptr + 2) < 4))
 				break;
-			
-			count++;
 		}
 
-		if (count > 10)
+		/* Search for the start of the first subroutine */
+		for (j = 4; j < 0x3ff; j++)
 		{
-			/* Search for the start of the first subroutine */
-			for (j = 4; j < 0x3ff; j++)
+			tmpptr = startptr - j;				
+			if (*tmpptr == 0xff || tmpptr < testptr)
+				break;
+				
+			length = ((*(tmpptr + 1) & 0x0f) << 8) + *(tmpptr + 2);
+			if (tmpptr + length == startptr)
 			{
-				tmpptr = startptr - j;				
-				if (*tmpptr == 0xff || tmpptr < testptr)
-					break;
-					
-				length = ((*(tmpptr + 1) & 0x0f) << 8) + *(tmpptr + 2);
-				if (tmpptr + length == startptr)
-				{
-					startptr = tmpptr;					
-					break;
-				}
+				startptr = tmpptr;					
+				break;
 			}
-			
-			if (*tmpptr != 0xff)
-			{ 		
-				*picdata = startptr;
-				*picsize = picptr - startptr;
-				return TRUE;
-			}		
 		}
+		
+		if (*tmpptr != 0xff)
+		{ 		
+			*picdata = startptr;
+			*picsize = picptr - startptr;
+			free(memo);
+			return TRUE;
+		}		
 	}
+	free(memo);
 	return FALSE;
 }
 
-L9BOOL intinitialise(char*filename,char*picname)
+/* work out the range each list may access, so this is not done on every list opcode */
+void setlistlimits(void)
 {
-/* init */
-/* driverclg */
-
 	int i;
-	int hdoffset;
-	long Offset;
-	FILE *f;
-
-	if (pictureaddress)
+	for (i=0;i<12;i++)
 	{
-		free(pictureaddress);
-		pictureaddress=NULL;
+		if (L9Pointers[i]>=workspace.listarea && L9Pointers[i]<workspace.listarea+LISTAREASIZE)
+		{
+			L9ListMin[i]=workspace.listarea;
+			L9ListMax[i]=workspace.listarea+LISTAREASIZE;
+		}
+		else
+		{
+			L9ListMin[i]=startdata;
+			L9ListMax[i]=startdata+FileSize;
+		}
 	}
-	picturedata=NULL;
-	picturesize=0;
-	gfxa5=NULL;
+}
+
+#ifndef NO_SCAN_CACHE
+/* a fingerprint of the data, the CRC-32 that zip uses, worked out a
+   nibble at a time so that the table is small */
+L9UINT32 scanhash(L9BYTE* data,L9UINT32 size)
+{
+	static const L9UINT32 table[16]={
+		0x00000000UL,0x1db71064UL,0x3b6e20c8UL,0x26d930acUL,
+		0x76dc4190UL,0x6b6b51f4UL,0x4db26158UL,0x5005713cUL,
+		0xedb88320UL,0xf00f9344UL,0xd6d6a3e8UL,0xcb61b38cUL,
+		0x9b64c2b0UL,0x86d3d2d4UL,0xa00ae278UL,0xbdbdf21cUL};
+	L9UINT32 crc=0xffffffffUL;
+	L9UINT32 i;
 
-	if (!load(filename))
+	for (i=0;i<size;i++)
 	{
-		error("\rUnable to load: %s\r",filename);
-		return FALSE;
+		crc^=data[i];
+		crc=(crc>>4)^table[crc&15];
+		crc=(crc>>4)^table[crc&15];
 	}
+	return crc^0xffffffffUL;
+}
 
-	/* try to load graphics */
-	if (picname)
-	{
-		f=fopen(picname,"rb");
-		if (f)
-		{
-			picturesize=filelength(f);
-			L9Allocate(&pictureaddress,picturesize);
-			if (fread(pictureaddress,1,picturesize,f)!=picturesize)
-			{
-				free(pictureaddress);
-				pictureaddress=NULL;
-				picturesize=0;
-			}
+/* the scan cache for a game is kept beside it, as <game file>.l9c */
+L9BOOL scancachename(char* name,char* filename)
+{
+	if (strlen(filename)+5>MAX_PATH) return FALSE;
+	sprintf(name,"%s.l9c",filename);
+	return TRUE;
+}
+
+/* works out the hashes of the game and picture files in scanresult, which
+   is left until a cache is read or written as it means reading them all */
+void hashscanned(void)
+{
+	if (scanresult.hashed) return;
+	scanresult.hash=scanhash(startfile,scanresult.size);
+	scanresult.picfilehash=scanresult.picfilesize ? scanhash(pictureaddress,scanresult.picfilesize) : 0;
+	scanresult.hashed=TRUE;
+}
+
+/* reads the scan cache for the loaded game, returning TRUE if it is there
+   and was written for the same game and picture files */
+L9BOOL readscancache(char* filename)
+{
+	char name[MAX_PATH];
+	ScanResult r;
+	unsigned long size,hash,picfilesize,picfilehash,picsize;
+	FILE *f;
+	int n;
+
+	scanresult.size=FileSize;
+	scanresult.picfilesize=pictureaddress ? picturesize : 0;
+	scanresult.hashed=FALSE;
+	if (Rescan || !scancachename(name,filename)) return FALSE;
+
+	f=fopen(name,"rt");
+	if (f==NULL) return FALSE;
+	n=fscanf(f,"L9SC2 %lu %lx %lu %lx %ld %d %d %d %ld %ld %ld %lu %d",
+		&size,&hash,&picfilesize,&picfilehash,&r.offset,&r.gametype,&r.msgtype,&r.v1game,
+		&r.acode,&r.dict,&r.picoffset,&picsize,&r.gfx);
+	fclose(f);
+	if (n!=13 || size!=scanresult.size || picfilesize!=scanresult.picfilesize)
+		return FALSE;
+	hashscanned();
+	if (hash!=scanresult.hash || picfilehash!=scanresult.picfilehash)
+		return FALSE;
+
+	/* the same file, but check that using it cannot go outside the data */
+	if (r.offset<0 || r.offset>=(long) FileSize || r.picoffset<-1
+		|| r.picoffset+(long) picsize>(long) (pictureaddress ? picturesize : FileSize))
+		return FALSE;
+	if (r.gametype==L9_V1 && (r.v1game<0 || r.v1game>=(int) (sizeof L9V1Games/sizeof L9V1Games[0])
+		|| r.acode<0 || r.acode>=(long) FileSize))
+		return FALSE;
+
+	r.size=scanresult.size;
+	r.hash=scanresult.hash;
+	r.picfilesize=scanresult.picfilesize;
+	r.picfilehash=scanresult.picfilehash;
+	r.hashed=TRUE;
+	r.picsize=picsize;
+	scanresult=r;
+	return TRUE;
+}
+
+/* writes scanresult to the scan cache, if SetScanCache() asked for it,
+   ignoring failure as the cache only saves time. The cache is written to
+   a file of its own and renamed, so that sessions of the game loading or
+   writing it at the same time never see half of it. */
+void writescancache(char* filename)
+{
+	char name[MAX_PATH],temp[MAX_PATH+32];
+	FILE *f;
+
+	/* the cache describes whole game files */
+	if (!ScanCache || streamed || !scancachename(name,filename)) return;
+	hashscanned();
+#ifdef L9CACHEPID
+	sprintf(temp,"%s.%ld.%lx",name,(long) getpid(),(unsigned long) l9ctx);
+#else
+	sprintf(temp,"%s.tmp",name);
+#endif
+	f=fopen(temp,"wt");
+	if (f==NULL) return;
+	fprintf(f,"L9SC2 %lu %lx %lu %lx %ld %d %d %d %ld %ld %ld %lu %d\n",
+		(unsigned long) scanresult.size,(unsigned long) scanresult.hash,
+		(unsigned long) scanresult.picfilesize,(unsigned long) scanresult.picfilehash,
+		scanresult.offset,scanresult.gametype,scanresult.msgtype,scanresult.v1game,
+		scanresult.acode,scanresult.dict,scanresult.picoffset,
+		(unsigned long) scanresult.picsize,scanresult.gfx);
+	if (fclose(f)!=0)
+	{
+		remove(temp);
+		return;
+	}
+	/* where rename() will not replace a file */
+	if (rename(temp,name)!=0)
+	{
+		remove(name);
+		if (rename(temp,name)!=0) remove(temp);
+	}
+}
+#endif
+
+/* makes the next loads scan the game file even if its scan cache is
+   valid, writing the cache again */
+void SetRescan(L9BOOL on)
+{
+	Rescan=on;
+}
+
+void SetScanCache(L9BOOL on)
+{
+	ScanCache=on;
+}
+
+void SetScanWindow(L9UINT32 size)
+{
+	scanwindow=size;
+}
+
+void SetPreloadLimit(L9UINT32 size)
+{
+	preloadlimit=size;
+}
+
+/* reads up to size bytes from offset from of f, returning how many */
+L9UINT32 readwindow(FILE *f,L9UINT32 from,L9UINT32 size,L9BYTE *data)
+{
+	if (fseek(f,from,SEEK_SET)!=0) return 0;
+	return fread(data,1,size,f);
+}
+
+/* looks for picture data in the part of f from From to To-1, as findsubs()
+   does, a window at a time; returns where it starts or -1 */
+long findsubswindows(FILE *f,L9BYTE *window,L9UINT32 wsize,L9UINT32 From,L9UINT32 To)
+{
+	L9BYTE *picdata;
+	L9UINT32 from,n,picsize;
+
+	for (from=From;from<To;from+=wsize-SCANSPAN)
+	{
+		n=readwindow(f,from,To-from<wsize ? To-from : wsize,window);
+		if (findsubs(window,n,&picdata,&picsize))
+			return from+(picdata-window);
+		if (from+n>=To) break;
+	}
+	return -1;
+}
+
+/* the length of the picture data from Pictures in f, ending before To,
+   following the subroutines from each header to the next as findsubs()
+   does, with the four bytes findsubs() looks at after the last */
+L9UINT32 picturelength(FILE *f,L9UINT32 Pictures,L9UINT32 To)
+{
+	L9BYTE h[4];
+	L9UINT32 p=Pictures,length;
+
+	while (readwindow(f,p,3,h)==3)
+	{
+		length=((h[1]&0x0f)<<8)+h[2];
+		if (length>0x3ff || p+length+4>To || readwindow(f,p+length-1,4,h)!=4 || h[0]!=0xff)
+			break;
+		p+=length;
+		if ((h[1]&0x80) || (h[2]&0x0c) || h[3]<4)
+			break;
+	}
+	return (p+4<To ? p+4 : To)-Pictures;
+}
+
+/* finds the game in a file bigger than the scan window a window at a time,
+   as ScanKnown(), Scan() and ScanV2() do, and reads SCANSPAN bytes from its
+   header into startfile. Unless there is a picture file, picture data in
+   the game file is looked for in the same way, from the header on and then
+   before it, and read into pictureaddress, however much of a window it
+   takes. Returns FALSE, leaving the file
+   to be read whole, if it is small enough or no V2, V3 or V4 game is found. */
+L9BOOL loadstream(char *filename)
+{
+	FILE *f;
+	L9BYTE *window;
+	L9UINT32 size,wsize,from,n,len,Size,MaxV3=0,MaxV2=0;
+	long Offset,Known=-1,V3=-1,V2=-1,Pictures=-1;
+	int KnownType=L9_V3;
+	L9BOOL DriverV4,V4=FALSE;
+
+	f=fopen(filename,"rb");
+	if (!f) return FALSE;
+	size=filelength(f);
+	wsize=scanwindow<2*SCANSPAN ? 2*SCANSPAN : scanwindow;
+	if (size<=wsize || (window=malloc(wsize))==NULL)
+	{
+		fclose(f);
+		return FALSE;
+	}
+
+	for (from=0;from<size;from+=wsize-SCANSPAN)
+	{
+		n=readwindow(f,from,wsize,window);
+		if (n<34) break;
+		/* a known game is taken wherever it is, so look no further */
+		if ((Offset=ScanKnown(window,n))>=0)
+		{
+			Known=from+Offset;
+			KnownType=L9GameType;
+			break;
+		}
+		Offset=ScanParts(ScanPartV3,window,n,n-33,&DriverV4,&Size);
+		if (Offset>=0 && Size>MaxV3)
+		{
+			V3=from+Offset;
+			MaxV3=Size;
+			V4=DriverV4;
+		}
+		Offset=ScanParts(ScanPartV2,window,n,n-28,NULL,&Size);
+		if (Offset>=0 && Size>MaxV2)
+		{
+			V2=from+Offset;
+			MaxV2=Size;
+		}
+		if (from+n>=size) break;
+	}
+	scanmemory+=wsize;
+
+	if (Known>=0)
+	{
+		Offset=Known;
+		L9GameType=KnownType;
+	}
+	else if (V3>=0)
+	{
+		Offset=V3;
+		L9GameType=V4 ? L9_V4 : L9_V3;
+	}
+	else if (V2>=0)
+	{
+		Offset=V2;
+		L9GameType=L9_V2;
+	}
+	else
+	{
+		free(window);
+		fclose(f);
+		return FALSE;
+	}
+#ifdef L9DEBUG
+	printf("stream scan found game at %ld",Offset);
+#endif
+
+	if (pictureaddress==NULL)
+	{
+		Pictures=findsubswindows(f,window,wsize,Offset,size);
+		if (Pictures<0)
+			Pictures=findsubswindows(f,window,wsize,0,Offset);
+	}
+	free(window);
+
+	if (startfile) freefile(startfile,startfilemap);
+	startfile=NULL;
+	startfilemap=0;
+	len=size-Offset<SCANSPAN ? size-Offset : SCANSPAN;
+	if ((startfile=malloc(len))==NULL || readwindow(f,Offset,len,startfile)!=len)
+	{
+		fclose(f);
+		return FALSE;
+	}
+	FileSize=len;
+
+	/* read from where the pictures start, up to the game or the end */
+	if (Pictures>=0)
+	{
+		len=picturelength(f,Pictures,Pictures<Offset ? (L9UINT32) Offset : size);
+		if ((pictureaddress=malloc(len))==NULL)
+			error("\rThere is not the memory for the pictures in the game file\r");
+		else
+		{
+			picturesize=readwindow(f,Pictures,len,pictureaddress);
+			picturemap=0;
+		}
+	}
+	fclose(f);
+	streamed=TRUE;
+	return TRUE;
+}
+
+L9BOOL intinitialise(char*filename,char*picname)
+{
+/* init */
+/* driverclg */
+
+	int i;
+	int hdoffset;
+	long Offset;
+	FILE *f;
+	L9BOOL cached=FALSE;
+	double t;
+
+	if (pictureaddress)
+	{
+		if (!sharedpictures) freefile(pictureaddress,picturemap);
+		pictureaddress=NULL;
+		sharedpictures=FALSE;
+		picturemap=0;
+	}
+	picturedata=NULL;
+	picturesize=0;
+	gfxa5=NULL;
+	scanmemory=0;
+	streamed=FALSE;
+	msgindexed=FALSE;
+	subindexed=FALSE;
+
+	/* try to load graphics */
+	if (picname)
+	{
+		t=loadstart();
+		f=fopen(picname,"rb");
+		if (f)
+		{
+			picturesize=filelength(f);
+			pictureaddress=readfile(f,picturesize,&picturemap);
+			if (pictureaddress==NULL)
+				picturesize=0;
 			fclose(f);
 		}
+		loadmemoryused(picturesize);
+		loadend(L9_LOAD_PICTURES,t);
+	}
+
+	t=loadstart();
+
+#ifdef L9PRELOAD
+	/* a part loaded in the background is ready to play */
+	if (!picname && takepreload(filename))
+		cached=TRUE;
+	else
+#endif
+	if (!(scanwindow && loadstream(filename)) && !load(filename))
+	{
+		error("\rUnable to load: %s\r",filename);
+		return FALSE;
 	}
+	loadend(L9_LOAD_FILE,t);
 	screencalled=0;
 	l9textmode=0;
 
@@ -1476,21 +3455,55 @@ L9BOOL intinitialise(char*filename,char*picname)
 	FullScan(startfile,FileSize);
 #endif
 
-	Offset=Scan(startfile,FileSize);
-	if (Offset<0)
+	scanresult.gfx=-1;
+#ifndef NO_SCAN_CACHE
+	if (!streamed && !cached)
+		cached=readscancache(filename);
+#endif
+	if (cached)
 	{
-		Offset=ScanV2(startfile,FileSize);
-		L9GameType=L9_V2;
+		Offset=scanresult.offset;
+		L9GameType=scanresult.gametype;
+		if (L9GameType==L9_V1)
+		{
+			/* as ScanV1() finds them */
+			L9V1Game=scanresult.v1game;
+			acodeptr=startfile+scanresult.acode;
+			dictdata=startfile+scanresult.dict;
+		}
+	}
+	else if (streamed)
+		Offset=0;
+	else
+	{
+		/* known games need only their header checking */
+		t=loadstart();
+		Offset=ScanKnown(startfile,FileSize);
+		if (Offset<0)
+			Offset=Scan(startfile,FileSize);
+		loadend(L9_LOAD_SCAN,t);
 		if (Offset<0)
 		{
-			Offset=ScanV1(startfile,FileSize);
-			L9GameType=L9_V1;
+			t=loadstart();
+			Offset=ScanV2(startfile,FileSize);
+			loadend(L9_LOAD_SCANV2,t);
+			L9GameType=L9_V2;
 			if (Offset<0)
 			{
-				error("\rUnable to locate valid Level 9 game in file: %s\r",filename);
-			 	return FALSE;
+				t=loadstart();
+				Offset=ScanV1(startfile,FileSize);
+				loadend(L9_LOAD_SCANV1,t);
+				L9GameType=L9_V1;
+				if (Offset<0)
+				{
+					error("\rUnable to locate valid Level 9 game in file: %s\r",filename);
+				 	return FALSE;
+				}
 			}
 		}
+#ifdef L9DEBUG
+		printf("scan used %ld bytes of scratch memory",(long) scanmemory);
+#endif
 	}
 
 	startdata=startfile+Offset;
@@ -1531,7 +3544,9 @@ L9BOOL intinitialise(char*filename,char*picname)
 		list9startptr=L9Pointers[10];
 		acodeptr=L9Pointers[11];
 	}
+	setlistlimits();
 
+	t=loadstart();
 	switch (L9GameType)
 	{
 		case L9_V1:
@@ -1540,7 +3555,12 @@ L9BOOL intinitialise(char*filename,char*picname)
 			startmd=acodeptr+L9V1Games[L9V1Game].msgStart;
 			startmdV2=startmd+L9V1Games[L9V1Game].msgLen;
 
-			if (analyseV1(&a1) && a1>2 && a1<10)
+			if (cached)
+			{
+				L9MsgType=scanresult.msgtype;
+				indexmessages(FALSE);
+			}
+			else if (analyseV1(&a1) && a1>2 && a1<10)
 			{
 				L9MsgType=MSGT_V1;
 				#ifdef L9DEBUG
@@ -1561,7 +3581,12 @@ L9BOOL intinitialise(char*filename,char*picname)
 			startmdV2=startdata + L9WORD(startdata+0x2);
 
 			/* determine message type */
-			if (analyseV2(&a2) && a2>2 && a2<10)
+			if (cached)
+			{
+				L9MsgType=scanresult.msgtype;
+				indexmessages(L9MsgType==MSGT_V2);
+			}
+			else if (analyseV2(&a2) && a2>2 && a2<10)
 			{
 				L9MsgType=MSGT_V2;
 				#ifdef L9DEBUG
@@ -1593,10 +3618,18 @@ L9BOOL intinitialise(char*filename,char*picname)
 			wordtable=startdata + L9WORD(startdata+0xe);
 			break;
 	}
+	loadend(L9_LOAD_MESSAGES,t);
 
+	t=loadstart();
 #ifndef NO_SCAN_GRAPHICS
+	if (cached)
+	{
+		picturedata = scanresult.picoffset < 0 ? NULL
+			: (pictureaddress ? pictureaddress : startfile) + scanresult.picoffset;
+		picturesize = scanresult.picsize;
+	}
 	/* If there was no graphics file, look in the game data */
-	if (pictureaddress)
+	else if (pictureaddress)
 	{
 		if (!findsubs(pictureaddress, picturesize, &picturedata, &picturesize))
 		{
@@ -1614,6 +3647,29 @@ L9BOOL intinitialise(char*filename,char*picname)
 		}
 	}
 #endif
+	indexsubs();
+	loadend(L9_LOAD_PICTUREDATA,t);
+
+	if (!cached)
+	{
+		scanresult.offset=Offset;
+		scanresult.gametype=L9GameType;
+		scanresult.msgtype=L9MsgType;
+		scanresult.v1game=L9V1Game;
+		scanresult.acode=L9GameType==L9_V1 ? acodeptr-startfile : 0;
+		scanresult.dict=L9GameType==L9_V1 ? dictdata-startfile : 0;
+		scanresult.picoffset=picturedata ? picturedata-(pictureaddress ? pictureaddress : startfile) : -1;
+		scanresult.picsize=picturesize;
+#ifndef NO_SCAN_CACHE
+		writescancache(filename);
+#endif
+	}
+
+#ifdef L9MMAP
+	/* the scanning is over, and games read their data in any order */
+	if (startfilemap) madvise(startfile,FileSize+Offset,MADV_NORMAL);
+	if (picturemap && !sharedpictures) madvise(pictureaddress,picturemap,MADV_NORMAL);
+#endif
 
 	memset(FirstLine,0,FIRSTLINESIZE);
 	FirstLinePos=0;
@@ -1659,12 +3715,7 @@ L9BYTE* getaddr(void)
 
 L9UINT16 *getvar(void)
 {
-#ifndef CODEFOLLOW
 	return workspace.vartable + *codeptr++;
-#else
-	cfvar2=cfvar;
-	return cfvar=workspace.vartable + *codeptr++;
-#endif
 }
 
 void Goto(void)
@@ -1785,8 +3836,18 @@ void driverosrdch(L9BYTE* a6)
 #endif
 
 	os_flush();
+	RunReason=L9_RUN_FLUSH;
 	if (Cheating) {
 		*a6 = '\r';
+	} else if (ResumableInput) {
+		if (!InputReady) {
+			/* park on the function opcode until a key is supplied */
+			codeptr-=2;
+			RunReason=InputWait=L9_NEED_KEY;
+			return;
+		}
+		InputReady=FALSE;
+		*a6=InputKey;
 	} else {
 		/* max delay of 1/50 sec */
 		*a6=os_readchar(20);
@@ -1936,9 +3997,6 @@ void calldriver(void)
 {
 	L9BYTE* a6=list9startptr;
 	int d0=*a6++;
-#ifdef CODEFOLLOW
-	fprintf(f," %s",drivercalls[d0]);
-#endif
 
 	if (d0==0x16 || d0==0x17)
 	{
@@ -1976,16 +4034,19 @@ void calldriver(void)
 
 void L9Random(void)
 {
-#ifdef CODEFOLLOW
-	fprintf(f," %d",randomseed);
-#endif
 	randomseed=(((randomseed<<8) + 0x0a - randomseed) <<2) + randomseed + 1;
 	*getvar()=randomseed & 0xff;
-#ifdef CODEFOLLOW
-	fprintf(f," %d",randomseed);
-#endif
 }
 
+/* the offset of the code pointer kept in a GameState, whose field codeptr
+   is named as the code pointer of the context is */
+#undef codeptr
+L9UINT16* savedcode(GameState* gs)
+{
+	return &gs->codeptr;
+}
+#define codeptr (l9ctx->codeptr)
+
 void save(void)
 {
 	L9UINT16 checksum;
@@ -1996,7 +4057,7 @@ void save(void)
 /* does a full save, workpace, stack, codeptr, stackptr, game name, checksum */
 
 	workspace.Id=L9_ID;
-	workspace.codeptr=codeptr-acodeptr;
+	*savedcode(&workspace)=codeptr-acodeptr;
 	workspace.listsize=LISTAREASIZE;
 	workspace.stacksize=STACKSIZE;
 	workspace.filenamesize=MAX_PATH;
@@ -2051,12 +4112,21 @@ L9BOOL CheckFile(GameState *gs)
 	if (StrCompare(gs->filename,LastGame))
 	{
 		printstring("\rWarning: game path name does not match, you may be about to load this position file into the wrong story file.\r");
-		printstring("Are you sure you want to restore? (Y/N)");
-		os_flush();
+		/* a game cannot be parked part way through a restore, so in
+		   resumable mode the question cannot be asked, and the answer
+		   is taken to be no */
+		if (ResumableInput)
+			c = 'N';
+		else
+		{
+			printstring("Are you sure you want to restore? (Y/N)");
+			os_flush();
+			RunReason=L9_RUN_FLUSH;
 
-		c = '\0';
-		while ((c != 'y') && (c != 'Y') && (c != 'n') && (c != 'N')) 
-			c = os_readchar(20);
+			c = '\0';
+			while ((c != 'y') && (c != 'Y') && (c != 'n') && (c != 'N')) 
+				c = os_readchar(20);
+		}
 	}
 	if ((c == 'y') || (c == 'Y'))
 		return TRUE;
@@ -2117,7 +4187,7 @@ void restore(void)
 			printstring("\rGame restored.\r");
 			/* full restore */
 			memmove(&workspace,&temp,sizeof(GameState));
-			codeptr=acodeptr+workspace.codeptr;
+			codeptr=acodeptr+*savedcode(&workspace);
 		}
 		else
 		{
@@ -2166,7 +4236,21 @@ void l9_fgets(char* s, int n, FILE* f)
 	}
 }
 
-L9BOOL scriptinput(char* ibuff, int size)
+/* reads a line into ibuff, or in resumable mode takes the line given to
+   L9SupplyInput(), parking the game if there is none yet */
+L9BOOL inputline(void)
+{
+	if (!ResumableInput) return os_input(ibuff,IBUFFSIZE);
+	if (!InputReady)
+	{
+		InputWait=L9_NEED_INPUT;
+		return FALSE;
+	}
+	InputReady=FALSE;
+	return TRUE;
+}
+
+L9BOOL scriptinput(char* buff, int size)
 {
 	while (scriptfile != NULL)
 	{
@@ -2177,9 +4261,9 @@ L9BOOL scriptinput(char* ibuff, int size)
 		}
 		else
 		{
-			char* p = ibuff;
+			char* p = buff;
 			*p = '\0';
-			l9_fgets(ibuff,size,scriptfile);
+			l9_fgets(buff,size,scriptfile);
 			while (*p != '\0')
 			{
 				switch (*p)
@@ -2191,7 +4275,7 @@ L9BOOL scriptinput(char* ibuff, int size)
 					*p = '\0';
 					break;
 				case '#':
-					if ((p==ibuff) && (StrCompareN(p,"#seed ",6)==0))
+					if ((p==buff) && (StrCompareN(p,"#seed ",6)==0))
 						p++;
 					else
 						*p = '\0';
@@ -2201,9 +4285,9 @@ L9BOOL scriptinput(char* ibuff, int size)
 					break;
 				}
 			}
-			if (*ibuff != '\0')
+			if (*buff != '\0')
 			{
-				printstring(ibuff);
+				printstring(buff);
 				lastchar=lastactualchar='.';
 				return TRUE;
 			}
@@ -2226,9 +4310,6 @@ void ilins(int d0)
 void function(void)
 {
 	int d0=*codeptr++;
-#ifdef CODEFOLLOW
-	fprintf(f," %s",d0==250 ? "printstr" : functions[d0-1]);
-#endif
 
 	switch (d0)
 	{
@@ -2381,7 +4462,7 @@ void NextCheat(void)
 {
 	/* restore game status */
 	memmove(&workspace,&CheatWorkspace,sizeof(GameState));
-	codeptr=acodeptr+workspace.codeptr;
+	codeptr=acodeptr+*savedcode(&workspace);
 
 	if (!((L9GameType<=L9_V2) ? GetWordV2(ibuff,CheatWord++) : GetWordV3(ibuff,CheatWord++)))
 	{
@@ -2398,7 +4479,7 @@ void StartCheat(void)
 
 	/* save current game status */
 	memmove(&CheatWorkspace,&workspace,sizeof(GameState));
-	CheatWorkspace.codeptr=codeptr-acodeptr;
+	*savedcode(&CheatWorkspace)=codeptr-acodeptr;
 
 	NextCheat();
 }
@@ -2488,6 +4569,55 @@ L9BOOL CheckHash(void)
 		playback();
 		return TRUE;
 	}
+	else if (StrCompare(ibuff,"#profile")==0)
+	{
+		if (Profiling)
+			ProfileReport();
+		else if (ProfileStart())
+			error("\rProfiling started\r");
+		lastactualchar = 0;
+		printchar('\r');
+		return TRUE;
+	}
+	else if (StrCompare(ibuff,"#profile off")==0)
+	{
+		ProfileStop();
+		lastactualchar = 0;
+		printchar('\r');
+		return TRUE;
+	}
+	else if (StrCompareN(ibuff,"#profile ",9)==0)
+	{
+		if (!ProfileWrite(ibuff+9))
+			error("\rUnable to write profile: %s\r",ibuff+9);
+		lastactualchar = 0;
+		printchar('\r');
+		return TRUE;
+	}
+	else if (StrCompare(ibuff,"#trace off")==0)
+	{
+		TraceStop();
+		lastactualchar = 0;
+		printchar('\r');
+		return TRUE;
+	}
+	else if (StrCompareN(ibuff,"#trace ",7)==0)
+	{
+		if (!TraceStart(ibuff+7))
+			error("\rUnable to create trace file: %s\r",ibuff+7);
+		lastactualchar = 0;
+		printchar('\r');
+		return TRUE;
+	}
+#ifdef FUSEDOPS
+	else if (StrCompare(ibuff,"#fusion")==0)
+	{
+		irreport();
+		lastactualchar = 0;
+		printchar('\r');
+		return TRUE;
+	}
+#endif
 	return FALSE;
 }
 
@@ -2519,7 +4649,7 @@ L9BOOL corruptinginput(void)
 			/* get input */
 			if (!scriptinput(ibuff,IBUFFSIZE))
 			{
-				if (!os_input(ibuff,IBUFFSIZE))
+				if (!inputline())
 					return FALSE; /* fall through */
 			}
 			if (CheckHash())
@@ -2703,7 +4833,7 @@ L9BOOL GetWordV2(char *buff,int Word)
 L9BOOL inputV2(int *wordcount)
 {
 	L9BYTE a,x;
-	L9BYTE *ibuffptr,*obuffptr,*ptr,*list0ptr;
+	L9BYTE *inptr,*obuffptr,*ptr,*list0ptr;
 	char *iptr;
 
 	if (Cheating) NextCheat();
@@ -2714,7 +4844,7 @@ L9BOOL inputV2(int *wordcount)
 		/* get input */
 		if (!scriptinput(ibuff,IBUFFSIZE))
 		{
-			if (!os_input(ibuff,IBUFFSIZE))
+			if (!inputline())
 				return FALSE; /* fall through */
 		}
 		if (CheckHash())
@@ -2731,21 +4861,21 @@ L9BOOL inputV2(int *wordcount)
 		os_printchar(lastactualchar='\r');
 	}
 	/* add space onto end */
-	ibuffptr=(L9BYTE*) strchr(ibuff,0);
-	*ibuffptr++=32;
-	*ibuffptr=0;
+	inptr=(L9BYTE*) strchr(ibuff,0);
+	*inptr++=32;
+	*inptr=0;
 
 	*wordcount=0;
-	ibuffptr=(L9BYTE*) ibuff;
+	inptr=(L9BYTE*) ibuff;
 	obuffptr=(L9BYTE*) obuff;
 	/* ibuffptr=76,77 */
 	/* obuffptr=84,85 */
 	/* list0ptr=7c,7d */
 	list0ptr=dictdata;
 
-	while (*ibuffptr==32) ++ibuffptr;
+	while (*inptr==32) ++inptr;
 
-	ptr=ibuffptr;
+	ptr=inptr;
 	do
 	{
 		while (*ptr==32) ++ptr;
@@ -2759,12 +4889,12 @@ L9BOOL inputV2(int *wordcount)
 
 	while (TRUE)
 	{
-		ptr=ibuffptr; /* 7a,7b */
-		while (*ibuffptr==32) ++ibuffptr;
+		ptr=inptr; /* 7a,7b */
+		while (*inptr==32) ++inptr;
 
 		while (TRUE)
 		{
-			a=*ibuffptr;
+			a=*inptr;
 			x=*list0ptr++;
 
 			if (a==32) break;
@@ -2774,7 +4904,7 @@ L9BOOL inputV2(int *wordcount)
 				return TRUE;
 			}
 
-			++ibuffptr;
+			++inptr;
 			if (!IsDictionaryChar(x&0x7f)) x = 0;
 			if (tolower(x&0x7f) != tolower(a))
 			{
@@ -2783,43 +4913,48 @@ L9BOOL inputV2(int *wordcount)
 				{
 					do
 					{
-						a=*ibuffptr++;
+						a=*inptr++;
 						if (a==0)
 						{
 							*obuffptr=0;
 							return TRUE;
 						}
 					} while (a!=32);
-					while (*ibuffptr==32) ++ibuffptr;
+					while (*inptr==32) ++inptr;
 					list0ptr=dictdata;
-					ptr=ibuffptr;
+					ptr=inptr;
 				}
 				else
 				{
 					list0ptr++;
-					ibuffptr=ptr;
+					inptr=ptr;
 				}
 			}
 			else if (x>=0x7f) break;
 		}
 
-		a=*ibuffptr;
+		a=*inptr;
 		if (a!=32)
 		{
-			ibuffptr=ptr;
+			inptr=ptr;
 			list0ptr+=2;
 			continue;
 		}
 		--list0ptr;
 		while (*list0ptr++<0x7e);
 		*obuffptr++=*list0ptr;
-		while (*ibuffptr==32) ++ibuffptr;
+		while (*inptr==32) ++inptr;
 		list0ptr=dictdata;
 	}
 }
 
 void input(void)
 {
+	if (booting)
+	{
+		loadstats[L9_LOAD_BOOT].seconds=loadclock()-bootstart;
+		booting=FALSE;
+	}
 	if (L9GameType == L9_V3 && FirstPicture >= 0)
 	{
 		show_picture(FirstPicture);
@@ -2846,46 +4981,31 @@ void input(void)
 	}
 	else
 		if (corruptinginput()) codeptr+=5;
+	RunReason=InputWait==L9_NEED_INPUT ? L9_NEED_INPUT : L9_RUN_INPUT;
 }
 
 void varcon(void)
 {
 	L9UINT16 d6=getcon();
 	*getvar()=d6;
-
-#ifdef CODEFOLLOW
-	fprintf(f," Var[%d]=%d)",cfvar-workspace.vartable,*cfvar);
-#endif
 }
 
 void varvar(void)
 {
 	L9UINT16 d6=*getvar();
 	*getvar()=d6;
-
-#ifdef CODEFOLLOW
-	fprintf(f," Var[%d]=Var[%d] (=%d)",cfvar-workspace.vartable,cfvar2-workspace.vartable,d6);
-#endif
 }
 
 void _add(void)
 {
 	L9UINT16 d0=*getvar();
 	*getvar()+=d0;
-
-#ifdef CODEFOLLOW
-	fprintf(f," Var[%d]+=Var[%d] (+=%d)",cfvar-workspace.vartable,cfvar2-workspace.vartable,d0);
-#endif
 }
 
 void _sub(void)
 {
 	L9UINT16 d0=*getvar();
 	*getvar()-=d0;
-
-#ifdef CODEFOLLOW
-	fprintf(f," Var[%d]-=Var[%d] (-=%d)",cfvar-workspace.vartable,cfvar2-workspace.vartable,d0);
-#endif
 }
 
 void jump(void)
@@ -2899,7 +5019,7 @@ void jump(void)
 }
 
 /* bug */
-void exit1(L9BYTE *d4,L9BYTE *d5,L9BYTE d6,L9BYTE d7)
+void exit1(L9BYTE *d4,L9BYTE *d5b,L9BYTE d6,L9BYTE d7)
 {
 	L9BYTE* a0=absdatablock;
 	L9BYTE d1=d7,d0;
@@ -2923,7 +5043,7 @@ void exit1(L9BYTE *d4,L9BYTE *d5,L9BYTE d6,L9BYTE d7)
 		*d4=*a0++;
 		if (((*d4)&0xf)==d6)
 		{
-			*d5=*a0;
+			*d5b=*a0;
 			return;
 		}
 		a0++;
@@ -2934,7 +5054,7 @@ void exit1(L9BYTE *d4,L9BYTE *d5,L9BYTE d6,L9BYTE d7)
 notfn4:
 	d6=exitreversaltable[d6];
 	a0=absdatablock;
-	*d5=1;
+	*d5b=1;
 
 	do
 	{
@@ -2942,27 +5062,20 @@ notfn4:
 		if (((*d4)&0x10)==0 || ((*d4)&0xf)!=d6) a0++;
 		else if (*a0++==d7) return;
 		/* exit6noinc */
-		if ((*d4)&0x80) (*d5)++;
+		if ((*d4)&0x80) (*d5b)++;
 	} while (*d4);
-	*d5=0;
+	*d5b=0;
 }
 
 void Exit(void)
 {
-	L9BYTE d4,d5;
+	L9BYTE d4,d5b;
 	L9BYTE d7=(L9BYTE) *getvar();
 	L9BYTE d6=(L9BYTE) *getvar();
-#ifdef CODEFOLLOW
-	fprintf(f," d7=%d d6=%d",d7,d6);
-#endif
-	exit1(&d4,&d5,d6,d7);
+	exit1(&d4,&d5b,d6,d7);
 
 	*getvar()=(d4&0x70)>>4;
-	*getvar()=d5;
-#ifdef CODEFOLLOW
-	fprintf(f," Var[%d]=%d(d4=%d) Var[%d]=%d",
-		cfvar2-workspace.vartable,(d4&0x70)>>4,d4,cfvar-workspace.vartable,d5);
-#endif
+	*getvar()=d5b;
 }
 
 void ifeqvt(void)
@@ -2971,10 +5084,6 @@ void ifeqvt(void)
 	L9UINT16 d1=*getvar();
 	L9BYTE* a0=getaddr();
 	if (d0==d1) codeptr=a0;
-
-#ifdef CODEFOLLOW
-	fprintf(f," if Var[%d]=Var[%d] goto %d (%s)",cfvar2-workspace.vartable,cfvar-workspace.vartable,(L9UINT32) (a0-acodeptr),d0==d1 ? "Yes":"No");
-#endif
 }
 
 void ifnevt(void)
@@ -2983,10 +5092,6 @@ void ifnevt(void)
 	L9UINT16 d1=*getvar();
 	L9BYTE* a0=getaddr();
 	if (d0!=d1) codeptr=a0;
-
-#ifdef CODEFOLLOW
-	fprintf(f," if Var[%d]!=Var[%d] goto %d (%s)",cfvar2-workspace.vartable,cfvar-workspace.vartable,(L9UINT32) (a0-acodeptr),d0!=d1 ? "Yes":"No");
-#endif
 }
 
 void ifltvt(void)
@@ -2995,10 +5100,6 @@ void ifltvt(void)
 	L9UINT16 d1=*getvar();
 	L9BYTE* a0=getaddr();
 	if (d0<d1) codeptr=a0;
-
-#ifdef CODEFOLLOW
-	fprintf(f," if Var[%d]<Var[%d] goto %d (%s)",cfvar2-workspace.vartable,cfvar-workspace.vartable,(L9UINT32) (a0-acodeptr),d0<d1 ? "Yes":"No");
-#endif
 }
 
 void ifgtvt(void)
@@ -3007,10 +5108,6 @@ void ifgtvt(void)
 	L9UINT16 d1=*getvar();
 	L9BYTE* a0=getaddr();
 	if (d0>d1) codeptr=a0;
-
-#ifdef CODEFOLLOW
-	fprintf(f," if Var[%d]>Var[%d] goto %d (%s)",cfvar2-workspace.vartable,cfvar-workspace.vartable,(L9UINT32) (a0-acodeptr),d0>d1 ? "Yes":"No");
-#endif
 }
 
 int scalex(int x)
@@ -3027,8 +5124,11 @@ void detect_gfx_mode(void)
 {
 	if (L9GameType == L9_V3)
 	{
+		/* Before the title is printed, use what was found on an earlier load */
+		if (FirstLine[0] == 0 && scanresult.gfx >= 0)
+			gfx_mode = scanresult.gfx;
 		/* These V3 games use graphics logic similar to the V2 games */
-		if (strstr(FirstLine,"price of magik") != 0)
+		else if (strstr(FirstLine,"price of magik") != 0)
 			gfx_mode = GFX_V3A;
 		else if (strstr(FirstLine,"the archers") != 0)
 			gfx_mode = GFX_V3A;
@@ -3055,6 +5155,14 @@ void detect_gfx_mode(void)
 	}
 	else
 		gfx_mode = GFX_V2;
+
+#ifndef NO_SCAN_CACHE
+	if (FirstLine[0] != 0 && gfx_mode != scanresult.gfx)
+	{
+		scanresult.gfx = gfx_mode;
+		writescancache(LastGame);
+	}
+#endif
 }
 
 void _screen(void)
@@ -3125,13 +5233,55 @@ L9BOOL validgfxptr(L9BYTE* a5)
 	return ((a5 >= picturedata) && (a5 < picturedata+picturesize));
 }
 
-L9BOOL findsub(int d0,L9BYTE** a5)
+/* notes where findsub() would find each subroutine, one past the offset
+   from picturedata, or 0 if it would not, in one walk through them all */
+void indexsubs(void)
 {
-	int d1,d2,d3,d4;
+	L9BYTE *a5=picturedata;
+	int d3,d4,n;
 
-	d1=d0 << 4;
-	d2=d1 >> 8;
-	*a5=picturedata;
+	subindexed=FALSE;
+	if (picturedata==NULL) return;
+	if (subindex==NULL && (subindex=malloc(SUBINDEXSIZE*sizeof(L9UINT32)))==NULL)
+		return;
+	memset(subindex,0,SUBINDEXSIZE*sizeof(L9UINT32));
+	while (TRUE)
+	{
+		d3=*a5++;
+		if (!validgfxptr(a5) || (d3&0x80))
+			break;
+		n=(d3<<4)|(*a5>>4);
+		if (subindex[n]==0)
+			subindex[n]=a5+2-picturedata+1;
+
+		d3=*a5++ & 0x0f;
+		if (!validgfxptr(a5))
+			break;
+		d4=*a5;
+		if ((d3|d4)==0)
+			break;
+		a5+=(d3<<8) + d4 - 2;
+		if (!validgfxptr(a5))
+			break;
+	}
+	subindexed=TRUE;
+}
+
+L9BOOL findsub(int d0,L9BYTE** a5)
+{
+	int d1,d2,d3,d4;
+
+	if (subindexed)
+	{
+		if (d0<0 || d0>=SUBINDEXSIZE || subindex[d0]==0)
+			return FALSE;
+		*a5=picturedata+subindex[d0]-1;
+		return TRUE;
+	}
+
+	d1=d0 << 4;
+	d2=d1 >> 8;
+	*a5=picturedata;
 /* findsubloop */
 	while (TRUE)
 	{
@@ -3700,9 +5850,6 @@ void ifeqct(void)
 	L9UINT16 d1=getcon();
 	L9BYTE* a0=getaddr();
 	if (d0==d1) codeptr=a0;
-#ifdef CODEFOLLOW
-	fprintf(f," if Var[%d]=%d goto %d (%s)",cfvar-workspace.vartable,d1,(L9UINT32) (a0-acodeptr),d0==d1 ? "Yes":"No");
-#endif
 }
 
 void ifnect(void)
@@ -3711,9 +5858,6 @@ void ifnect(void)
 	L9UINT16 d1=getcon();
 	L9BYTE* a0=getaddr();
 	if (d0!=d1) codeptr=a0;
-#ifdef CODEFOLLOW
-	fprintf(f," if Var[%d]!=%d goto %d (%s)",cfvar-workspace.vartable,d1,(L9UINT32) (a0-acodeptr),d0!=d1 ? "Yes":"No");
-#endif
 }
 
 void ifltct(void)
@@ -3722,9 +5866,6 @@ void ifltct(void)
 	L9UINT16 d1=getcon();
 	L9BYTE* a0=getaddr();
 	if (d0<d1) codeptr=a0;
-#ifdef CODEFOLLOW
-	fprintf(f," if Var[%d]<%d goto %d (%s)",cfvar-workspace.vartable,d1,(L9UINT32) (a0-acodeptr),d0<d1 ? "Yes":"No");
-#endif
 }
 
 void ifgtct(void)
@@ -3733,9 +5874,6 @@ void ifgtct(void)
 	L9UINT16 d1=getcon();
 	L9BYTE* a0=getaddr();
 	if (d0>d1) codeptr=a0;
-#ifdef CODEFOLLOW
-	fprintf(f," if Var[%d]>%d goto %d (%s)",cfvar-workspace.vartable,d1,(L9UINT32) (a0-acodeptr),d0>d1 ? "Yes":"No");
-#endif
 }
 
 void printinput(void)
@@ -3754,9 +5892,6 @@ void listhandler(void)
 	L9BYTE *a4,*MinAccess,*MaxAccess;
 	L9UINT16 val;
 	L9UINT16 *var;
-#ifdef CODEFOLLOW
-	int offset; 
-#endif
 
 	if ((code&0x1f)>0xa)
 	{
@@ -3764,51 +5899,36 @@ void listhandler(void)
 		Running=FALSE;
 		return;
 	}
-	a4=L9Pointers[1+code&0x1f];
-
-	if (a4>=workspace.listarea && a4<workspace.listarea+LISTAREASIZE)
-	{
-		MinAccess=workspace.listarea;
-		MaxAccess=workspace.listarea+LISTAREASIZE;
-	}
-	else
-	{
-		MinAccess=startdata;
-		MaxAccess=startdata+FileSize;
-	}
+	a4=L9Pointers[1+(code&0x1f)];
+	MinAccess=L9ListMin[1+(code&0x1f)];
+	MaxAccess=L9ListMax[1+(code&0x1f)];
 
 	if (code>=0xe0)
 	{
 		/* listvv */
-#ifndef CODEFOLLOW
 		a4+=*getvar();
 		val=*getvar();
-#else
-		offset=*getvar();
-		a4+=offset;
-		var=getvar();
-		val=*var;
-		fprintf(f," list %d [%d]=Var[%d] (=%d)",code&0x1f,offset,var-workspace.vartable,val);
-#endif
 
-		if (a4>=MinAccess && a4<MaxAccess) *a4=(L9BYTE) val;
+		if (a4>=MinAccess && a4<MaxAccess)
+		{
+			*a4=(L9BYTE) val;
+			MARKDIRTY(a4);
+		}
 		#ifdef L9DEBUG
 		else printf("Out of range list access");
 		#endif
+#ifdef PREDECODE
+		if (a4>=irlow && a4<irhigh) irflush();
+#endif
+#ifdef AOTCODE
+		if (a4>=aotlow && a4<aothigh) aotvalid=FALSE;
+#endif
 	}
 	else if (code>=0xc0)
 	{
 		/* listv1c */
-#ifndef CODEFOLLOW
 		a4+=*codeptr++;
 		var=getvar();
-#else
-		offset=*codeptr++;
-		a4+=offset;
-		var=getvar();
-		fprintf(f," Var[%d]= list %d [%d])",var-workspace.vartable,code&0x1f,offset);
-		if (a4>=MinAccess && a4<MaxAccess) fprintf(f," (=%d)",*a4);
-#endif
 
 		if (a4>=MinAccess && a4<MaxAccess) *var=*a4;
 		else
@@ -3822,17 +5942,8 @@ void listhandler(void)
 	else if (code>=0xa0)
 	{
 		/* listv1v */
-#ifndef CODEFOLLOW
 		a4+=*getvar();
 		var=getvar();
-#else
-		offset=*getvar();
-		a4+=offset;
-		var=getvar();
-
-		fprintf(f," Var[%d] =list %d [%d]",var-workspace.vartable,code&0x1f,offset);
-		if (a4>=MinAccess && a4<MaxAccess) fprintf(f," (=%d)",*a4);
-#endif
 
 		if (a4>=MinAccess && a4<MaxAccess) *var=*a4;
 		else
@@ -3845,33 +5956,28 @@ void listhandler(void)
 	}
 	else
 	{
-#ifndef CODEFOLLOW
 		a4+=*codeptr++;
 		val=*getvar();
-#else
-		offset=*codeptr++;
-		a4+=offset;
-		var=getvar();
-		val=*var;
-		fprintf(f," list %d [%d]=Var[%d] (=%d)",code&0x1f,offset,var-workspace.vartable,val);
-#endif
 
-		if (a4>=MinAccess && a4<MaxAccess) *a4=(L9BYTE) val;
+		if (a4>=MinAccess && a4<MaxAccess)
+		{
+			*a4=(L9BYTE) val;
+			MARKDIRTY(a4);
+		}
 		#ifdef L9DEBUG
 		else printf("Out of range list access");
 		#endif
+#ifdef PREDECODE
+		if (a4>=irlow && a4<irhigh) irflush();
+#endif
+#ifdef AOTCODE
+		if (a4>=aotlow && a4<aothigh) aotvalid=FALSE;
+#endif
 	}
 }
 
 void executeinstruction(void)
 {
-#ifdef CODEFOLLOW
-	f=fopen(CODEFOLLOWFILE,"a");
-	fprintf(f,"%ld (s:%d) %x",(L9UINT32) (codeptr-acodeptr)-1,workspace.stackptr,code);
-	if (!(code&0x80))
-		fprintf(f," = %s",codes[code&0x1f]);
-#endif
-
 	if (code & 0x80)
 		listhandler();
 	else
@@ -3912,26 +6018,1284 @@ void executeinstruction(void)
 			case 31:	ilins(code & 0x1f);break;
 		}
 	}
-#ifdef CODEFOLLOW
-	fprintf(f,"\n");
-	fclose(f);
+}
+
+/* Execution trace. Each opcode run while tracing adds a record to a ring
+   of blocks in memory, and full blocks are written out by a background
+   thread where there is one, or straight away where there is not.
+   Tools/l9trace turns the file back into text. */
+
+/* a trace record, stored little endian:
+   0-3 A-code offset, 4 opcode, 5 flags, 6-7 stack depth, 8 variable set
+   or read, 9 other variable read, 10-11 value of the first after the
+   opcode, 12-13 value of the other before it, 14-15 unused */
+#define TRACERECSIZE 16
+#define TRACEVAR 1		/* the first variable and value are set */
+#define TRACEVAR2 2		/* the other variable and value are set */
+#define TRACEBLOCK 4096		/* records written out at a time */
+
+#ifdef L9THREADS
+void* tracewriter(void* arg)
+{
+	int block=0,n;
+
+	l9ctx=(L9Context*) arg;
+	pthread_mutex_lock(&tracemutex);
+	while (TRUE)
+	{
+		while (tracefull[block]==0 && !tracequit)
+			pthread_cond_wait(&tracecond,&tracemutex);
+		if ((n=tracefull[block])==0) break;
+		pthread_mutex_unlock(&tracemutex);
+		fwrite(tracebuf+block*TRACEBLOCK*TRACERECSIZE,TRACERECSIZE,n,tracefile);
+		pthread_mutex_lock(&tracemutex);
+		tracefull[block]=0;
+		block=(block+1)%TRACEBLOCKS;
+		pthread_cond_broadcast(&tracecond);
+	}
+	pthread_mutex_unlock(&tracemutex);
+	return NULL;
+}
 #endif
+
+/* passes the block being filled on to be written, and moves to the next */
+void traceblockdone(void)
+{
+#ifdef L9THREADS
+	pthread_mutex_lock(&tracemutex);
+	tracefull[traceblock]=tracepos;
+	traceblock=(traceblock+1)%TRACEBLOCKS;
+	pthread_cond_broadcast(&tracecond);
+	while (tracefull[traceblock])
+		pthread_cond_wait(&tracecond,&tracemutex);
+	pthread_mutex_unlock(&tracemutex);
+#else
+	fwrite(tracebuf,TRACERECSIZE,tracepos,tracefile);
+#endif
+	tracepos=0;
+}
+
+void TraceStop(void)
+{
+	if (!Tracing) return;
+	Tracing=FALSE;
+	traceserial++;
+	if (tracepos>0) traceblockdone();
+#ifdef L9THREADS
+	pthread_mutex_lock(&tracemutex);
+	tracequit=TRUE;
+	pthread_cond_broadcast(&tracecond);
+	pthread_mutex_unlock(&tracemutex);
+	pthread_join(tracethread,NULL);
+	pthread_mutex_destroy(&tracemutex);
+	pthread_cond_destroy(&tracecond);
+#endif
+	fclose(tracefile);
+	tracefile=NULL;
+	free(tracebuf);
+	tracebuf=NULL;
 }
 
-L9BOOL LoadGame2(char *filename,char *picname)
+L9BOOL TraceStart(char* filename)
 {
-#ifdef CODEFOLLOW
-	f=fopen(CODEFOLLOWFILE,"w");
-	fprintf(f,"Code follow file...\n");
+	static L9BYTE header[8]={'L','9','T','R',1,TRACERECSIZE,0,0};
+
+	TraceStop();
+	if ((tracefile=fopen(filename,"wb"))==NULL) return FALSE;
+#ifdef L9THREADS
+	tracebuf=malloc(TRACEBLOCKS*TRACEBLOCK*TRACERECSIZE);
+#else
+	tracebuf=malloc(TRACEBLOCK*TRACERECSIZE);
+#endif
+	if (tracebuf==NULL)
+	{
+		fclose(tracefile);
+		tracefile=NULL;
+		return FALSE;
+	}
+	fwrite(header,1,sizeof(header),tracefile);
+	traceblock=tracepos=0;
+#ifdef L9THREADS
+	memset(tracefull,0,sizeof(tracefull));
+	tracequit=FALSE;
+	pthread_mutex_init(&tracemutex,NULL);
+	pthread_cond_init(&tracecond,NULL);
+	if (pthread_create(&tracethread,NULL,tracewriter,l9ctx)!=0)
+	{
+		pthread_mutex_destroy(&tracemutex);
+		pthread_cond_destroy(&tracecond);
+		fclose(tracefile);
+		tracefile=NULL;
+		free(tracebuf);
+		tracebuf=NULL;
+		return FALSE;
+	}
+#endif
+	Tracing=TRUE;
+	traceserial++;
+	return TRUE;
+}
+
+/* finds the variable an opcode sets or else reads first, and any other
+   variable it reads, as -1 if there are none */
+void tracevariables(L9BYTE* ptr,int* var,int* var2)
+{
+	int c=*ptr;
+	*var=*var2=-1;
+	if (c&0x80)
+	{
+		*var=ptr[2];
+		if (c&0x20) *var2=ptr[1];
+	}
+	else switch (c&0x1f)
+	{
+		case 3: /* printnumber */
+		case 4: /* messagev */
+		case 24: /* ifeqct */
+		case 25: /* ifnect */
+		case 26: /* ifltct */
+		case 27: /* ifgtct */
+			*var=ptr[1];
+			break;
+		case 16: /* ifeqvt */
+		case 17: /* ifnevt */
+		case 18: /* ifltvt */
+		case 19: /* ifgtvt */
+			*var=ptr[1];
+			*var2=ptr[2];
+			break;
+		case 8: /* varcon */
+			*var=ptr[(c&0x40) ? 2 : 3];
+			break;
+		case 9: /* varvar */
+		case 10: /* _add */
+		case 11: /* _sub */
+			*var=ptr[2];
+			*var2=ptr[1];
+			break;
+		case 14: /* jump */
+			*var=ptr[3];
+			break;
+	}
+}
+
+/* runs one opcode, adding it to the trace */
+void traceinstruction(void)
+{
+	L9BYTE* ptr=codeptr;
+	L9BYTE* rec=tracebuf+(traceblock*TRACEBLOCK+tracepos)*TRACERECSIZE;
+	L9UINT32 pc=(L9UINT32) (ptr-acodeptr);
+	int serial=traceserial;
+	int var,var2;
+
+	tracevariables(ptr,&var,&var2);
+	memset(rec,0,TRACERECSIZE);
+	rec[0]=(L9BYTE) pc;
+	rec[1]=(L9BYTE) (pc>>8);
+	rec[2]=(L9BYTE) (pc>>16);
+	rec[3]=(L9BYTE) (pc>>24);
+	rec[4]=*ptr;
+	rec[6]=(L9BYTE) workspace.stackptr;
+	rec[7]=(L9BYTE) (workspace.stackptr>>8);
+	if (var2>=0)
+	{
+		rec[5]|=TRACEVAR2;
+		rec[9]=(L9BYTE) var2;
+		rec[12]=(L9BYTE) workspace.vartable[var2];
+		rec[13]=(L9BYTE) (workspace.vartable[var2]>>8);
+	}
+
+	code=*codeptr++;
+	executeinstruction();
+
+	/* the opcode may have stopped or restarted the trace */
+	if (traceserial!=serial) return;
+	if (var>=0)
+	{
+		rec[5]|=TRACEVAR;
+		rec[8]=(L9BYTE) var;
+		rec[10]=(L9BYTE) workspace.vartable[var];
+		rec[11]=(L9BYTE) (workspace.vartable[var]>>8);
+	}
+	if (++tracepos==TRACEBLOCK) traceblockdone();
+}
+
+/* Execution profile: counts of opcodes run by kind and by A-code address.
+   Each gosub site is an address of its own, so its count is the number of
+   calls it made. */
+#define PROFILETOP 20		/* lines in each part of the report */
+
+char* ProfileNames[PROFILEKINDS]=
+{
+	"Goto","intgosub","intreturn","printnumber","messagev","messagec",
+	"function","input","varcon","varvar","_add","_sub","ilins","ilins",
+	"jump","Exit","ifeqvt","ifnevt","ifltvt","ifgtvt","screen","cleartg",
+	"picture","getnextobject","ifeqct","ifnect","ifltct","ifgtct",
+	"printinput","ilins","ilins","ilins",
+	"list1v","listv1v","listv1c","listvv"
+};
+
+int profilekind(int c)
+{
+	return (c&0x80) ? 32+((c>>5)&3) : c&0x1f;
+}
+
+void ProfileStop(void)
+{
+	Profiling=FALSE;
+	free(ProfileCounts);
+	ProfileCounts=NULL;
+	ProfileSize=0;
+}
+
+/* starts profiling the current game, clearing any earlier counts */
+L9BOOL ProfileStart(void)
+{
+	ProfileStop();
+	memset(ProfileKinds,0,sizeof(ProfileKinds));
+	if (startdata==NULL) return FALSE;
+	if ((ProfileCounts=calloc(FileSize,sizeof(L9UINT32)))==NULL) return FALSE;
+	ProfileSize=FileSize;
+	Profiling=TRUE;
+	return TRUE;
+}
+
+/* orders game data offsets by count, highest first */
+int profilecompare(const void* a,const void* b)
+{
+	L9UINT32 ca=ProfileCounts[*(const L9UINT32*) a];
+	L9UINT32 cb=ProfileCounts[*(const L9UINT32*) b];
+	if (ca!=cb) return ca<cb ? 1 : -1;
+	return *(const L9UINT32*) a<*(const L9UINT32*) b ? -1 : 1;
+}
+
+/* the A-code offset a gosub at game data offset i calls */
+long profiletarget(L9UINT32 i)
+{
+	L9BYTE* p=startdata+i;
+	if (p[0]&0x20) return (long) (p+1-acodeptr)+(signed char) p[1];
+	return L9WORD(p+1);
+}
+
+/* lists the game data offsets that were run, busiest first */
+L9UINT32* profilesites(L9UINT32* n)
+{
+	L9UINT32 i,*sites;
+	*n=0;
+	if ((sites=malloc((ProfileSize+1)*sizeof(L9UINT32)))==NULL) return NULL;
+	for (i=0;i<ProfileSize;i++)
+		if (ProfileCounts[i]) sites[(*n)++]=i;
+	qsort(sites,*n,sizeof(L9UINT32),profilecompare);
+	return sites;
+}
+
+/* prints the busiest opcodes, addresses and subroutines */
+void ProfileReport(void)
+{
+	L9UINT32 total=0,n,i,j,*sites,*order;
+	long acode=(long) (acodeptr-startdata);
+	int k,kinds[PROFILEKINDS];
+
+	if (!Profiling)
+	{
+		error("\rNot profiling\r");
+		return;
+	}
+	for (k=0;k<PROFILEKINDS;k++)
+	{
+		total+=ProfileKinds[k];
+		kinds[k]=k;
+	}
+	/* a few dozen kinds, so a simple sort will do */
+	for (k=1;k<PROFILEKINDS;k++)
+	{
+		int m=kinds[k],l=k;
+		while (l>0 && ProfileKinds[kinds[l-1]]<ProfileKinds[m])
+		{
+			kinds[l]=kinds[l-1];
+			l--;
+		}
+		kinds[l]=m;
+	}
+	error("\rOpcodes run: %lu\r",(unsigned long) total);
+	for (k=0;k<PROFILEKINDS && ProfileKinds[kinds[k]];k++)
+		error("%-14s %10lu %5.1f%%\r",ProfileNames[kinds[k]],(unsigned long) ProfileKinds[kinds[k]],
+			100.0*ProfileKinds[kinds[k]]/total);
+
+	if ((sites=profilesites(&n))==NULL) return;
+	error("\rBusiest addresses:\r");
+	for (i=0;i<n && i<PROFILETOP;i++)
+		error("%6ld %10lu  %s\r",(long) sites[i]-acode,(unsigned long) ProfileCounts[sites[i]],
+			ProfileNames[profilekind(startdata[sites[i]])]);
+
+	/* gosub sites by target, busiest target first */
+	error("\rBusiest subroutines:\r");
+	if ((order=malloc((n+1)*sizeof(L9UINT32)))!=NULL)
+	{
+		L9UINT32 m=0;
+		for (i=0;i<n;i++)
+			if (profilekind(startdata[sites[i]])==1) order[m++]=sites[i];
+		for (i=0,k=0;i<m && k<PROFILETOP;i++)
+		{
+			long target=profiletarget(order[i]);
+			L9UINT32 calls=0;
+			L9BOOL seen=FALSE;
+			for (j=0;j<i && !seen;j++)
+				seen=profiletarget(order[j])==target;
+			if (seen) continue;
+			for (j=i;j<m;j++)
+				if (profiletarget(order[j])==target) calls+=ProfileCounts[order[j]];
+			error("%6ld %10lu  from",target,(unsigned long) calls);
+			for (j=i;j<m;j++)
+				if (profiletarget(order[j])==target)
+					error(" %ld:%lu",(long) order[j]-acode,(unsigned long) ProfileCounts[order[j]]);
+			error("\r");
+			k++;
+		}
+		free(order);
+	}
+	free(sites);
+}
+
+/* writes the counts as tab separated lines for other programs to read */
+L9BOOL ProfileWrite(char* filename)
+{
+	L9UINT32 n,i,*sites;
+	long acode=(long) (acodeptr-startdata);
+	FILE* f;
+	int k;
+
+	if (!Profiling || (f=fopen(filename,"w"))==NULL) return FALSE;
+	fprintf(f,"# kind\tname\tcount\n");
+	for (k=0;k<PROFILEKINDS;k++)
+		if (ProfileKinds[k]) fprintf(f,"op\t%s\t%lu\n",ProfileNames[k],(unsigned long) ProfileKinds[k]);
+	fprintf(f,"# addr\toffset\topcode\tcount\n");
+	if ((sites=profilesites(&n))!=NULL)
+	{
+		for (i=0;i<n;i++)
+			fprintf(f,"addr\t%ld\t%s\t%lu\n",(long) sites[i]-acode,
+				ProfileNames[profilekind(startdata[sites[i]])],(unsigned long) ProfileCounts[sites[i]]);
+		fprintf(f,"# gosub\ttarget\tsite\tcount\n");
+		for (i=0;i<n;i++)
+			if (profilekind(startdata[sites[i]])==1)
+				fprintf(f,"gosub\t%ld\t%ld\t%lu\n",profiletarget(sites[i]),(long) sites[i]-acode,
+					(unsigned long) ProfileCounts[sites[i]]);
+		free(sites);
+	}
 	fclose(f);
+	return TRUE;
+}
+
+char* LoadPhaseNames[L9_LOAD_PHASES]=
+{
+	"file","pictures","scan","scanv2","scanv1","messages","picturedata","boot"
+};
+
+void SetLoadStats(L9BOOL on)
+{
+	LoadStats=on;
+}
+
+const L9LoadStat* GetLoadStats(void)
+{
+	return loadstats;
+}
+
+void LoadStatsReport(void)
+{
+	double total=0;
+	int i;
+
+	if (!LoadStats)
+	{
+		error("\rNot keeping load statistics\r");
+		return;
+	}
+	error("\rLoad phase          ms      bytes\r");
+	for (i=0;i<L9_LOAD_PHASES;i++)
+	{
+		error("%-12s %9.3f %10lu\r",LoadPhaseNames[i],loadstats[i].seconds*1000,(unsigned long) loadstats[i].bytes);
+		total+=loadstats[i].seconds;
+	}
+	error("%-12s %9.3f\r","total",total*1000);
+}
+
+/* adds a line to the file, so that one file can collect several games */
+L9BOOL LoadStatsWrite(char* filename)
+{
+	double total=0;
+	FILE* f;
+	char* p;
+	int i;
+
+	if (!LoadStats || startfile==NULL || (f=fopen(filename,"a"))==NULL) return FALSE;
+	fprintf(f,"{\"game\": \"");
+	for (p=LastGame;*p;p++)
+	{
+		if (*p=='"' || *p=='\\') fputc('\\',f);
+		fputc(*p,f);
+	}
+	fprintf(f,"\", \"size\": %lu, \"type\": \"V%d\", \"phases\": {",
+		(unsigned long) (FileSize+(startdata-startfile)),L9GameType+1);
+	for (i=0;i<L9_LOAD_PHASES;i++)
+	{
+		fprintf(f,"%s\"%s\": {\"ms\": %.3f, \"bytes\": %lu}",i ? ", " : "",
+			LoadPhaseNames[i],loadstats[i].seconds*1000,(unsigned long) loadstats[i].bytes);
+		total+=loadstats[i].seconds;
+	}
+	fprintf(f,"}, \"total_ms\": %.3f}\n",total*1000);
+	fclose(f);
+	return TRUE;
+}
+
+/* runs one opcode with tracing or profiling */
+void slowinstruction(void)
+{
+	if (Profiling)
+	{
+		L9UINT32 i=(L9UINT32) (codeptr-startdata);
+		ProfileKinds[profilekind(*codeptr)]++;
+		if (i<ProfileSize) ProfileCounts[i]++;
+	}
+	if (Tracing)
+		traceinstruction();
+	else
+	{
+		code=*codeptr++;
+		executeinstruction();
+	}
+}
+
+#ifdef THREADEDCODE
+/* runs up to n opcodes, dispatching through a table of label addresses
+   rather than the switch in executeinstruction. The common opcodes are
+   decoded inline with codeptr held in a local; the rest go through
+   executeinstruction as usual */
+void executethreaded(L9UINT32 n)
+{
+	/* GCC range designators, as labels as values are GCC only anyway.
+	   Each opcode comes in four forms, with bits 0x20 and 0x40 set or not */
+#define OP4(c,l0,l20,l40,l60) [c]=&&l0,[c|0x20]=&&l20,[c|0x40]=&&l40,[c|0x60]=&&l60
+#define LIST(c,l) [c ... c+0xa]=&&l,[c+0xb ... c+0x1f]=&&listillegal
+	static void* const optable[256]=
+	{
+		[0 ... 0x7f]=&&legacy,
+		OP4(0x00,goto_l,goto_s,goto_l,goto_s),
+		OP4(0x01,gosub_l,gosub_s,gosub_l,gosub_s),
+		OP4(0x02,ret,ret,ret,ret),
+		OP4(0x08,varcon_l,varcon_l,varcon_s,varcon_s),
+		OP4(0x09,varvar,varvar,varvar,varvar),
+		OP4(0x0a,add,add,add,add),
+		OP4(0x0b,sub,sub,sub,sub),
+		OP4(0x0e,jmp,jmp,jmp,jmp),
+		OP4(0x10,ifeqvt_l,ifeqvt_s,ifeqvt_l,ifeqvt_s),
+		OP4(0x11,ifnevt_l,ifnevt_s,ifnevt_l,ifnevt_s),
+		OP4(0x12,ifltvt_l,ifltvt_s,ifltvt_l,ifltvt_s),
+		OP4(0x13,ifgtvt_l,ifgtvt_s,ifgtvt_l,ifgtvt_s),
+		OP4(0x18,ifeqct_ll,ifeqct_ls,ifeqct_sl,ifeqct_ss),
+		OP4(0x19,ifnect_ll,ifnect_ls,ifnect_sl,ifnect_ss),
+		OP4(0x1a,ifltct_ll,ifltct_ls,ifltct_sl,ifltct_ss),
+		OP4(0x1b,ifgtct_ll,ifgtct_ls,ifgtct_sl,ifgtct_ss),
+		LIST(0x80,list1v),LIST(0xa0,listv1v),LIST(0xc0,listv1c),LIST(0xe0,listvv)
+	};
+#undef OP4
+#undef LIST
+	L9BYTE* pc=codeptr;
+	L9UINT16* vars=workspace.vartable;
+	L9BYTE *a0,*a4;
+	L9UINT16 d0,d1;
+	L9BYTE op;
+	int i;
+
+#define NEXT		if (n--==0) goto done; op=*pc++; goto *optable[op]
+#define ADDRSHORT	a0=pc+(signed char) *pc; pc++
+#define ADDRLONG	a0=acodeptr+L9WORD(pc); pc+=2
+#define CONSMALL	d1=*pc++
+#define CONLONG		d1=L9WORD(pc); pc+=2
+#define IFVT(lbl,get,cmp)	lbl: d0=vars[*pc++]; d1=vars[*pc++]; get; if (d0 cmp d1) pc=a0; NEXT
+#define IFCT(lbl,con,get,cmp)	lbl: d0=vars[*pc++]; con; get; if (d0 cmp d1) pc=a0; NEXT
+
+	NEXT;
+
+goto_s:
+	ADDRSHORT;
+	goto gotocheck;
+goto_l:
+	ADDRLONG;
+gotocheck:
+	if (a0==pc-2)
+	{
+		Running=FALSE; /* Endless loop! */
+		goto done;
+	}
+	pc=a0;
+	NEXT;
+
+gosub_s:
+	ADDRSHORT;
+	goto gosubpush;
+gosub_l:
+	ADDRLONG;
+gosubpush:
+	if (workspace.stackptr==STACKSIZE)
+	{
+		error("\rStack overflow error\r");
+		Running=FALSE;
+		goto done;
+	}
+	workspace.stack[workspace.stackptr++]=(L9UINT16) (pc-acodeptr);
+	pc=a0;
+	NEXT;
+
+ret:
+	if (workspace.stackptr==0)
+	{
+		error("\rStack underflow error\r");
+		Running=FALSE;
+		goto done;
+	}
+	pc=acodeptr+workspace.stack[--workspace.stackptr];
+	NEXT;
+
+varcon_s:
+	CONSMALL;
+	vars[*pc++]=d1;
+	NEXT;
+varcon_l:
+	CONLONG;
+	vars[*pc++]=d1;
+	NEXT;
+
+varvar:
+	d0=vars[*pc++];
+	vars[*pc++]=d0;
+	NEXT;
+add:
+	d0=vars[*pc++];
+	vars[*pc++]+=d0;
+	NEXT;
+sub:
+	d0=vars[*pc++];
+	vars[*pc++]-=d0;
+	NEXT;
+
+jmp:
+	d0=L9WORD(pc);
+	pc+=2;
+	a0=acodeptr+((d0+(vars[*pc++]<<1))&0xffff);
+	pc=acodeptr+L9WORD(a0);
+	NEXT;
+
+	IFVT(ifeqvt_l,ADDRLONG,==);
+	IFVT(ifnevt_l,ADDRLONG,!=);
+	IFVT(ifltvt_l,ADDRLONG,<);
+	IFVT(ifgtvt_l,ADDRLONG,>);
+	IFVT(ifeqvt_s,ADDRSHORT,==);
+	IFVT(ifnevt_s,ADDRSHORT,!=);
+	IFVT(ifltvt_s,ADDRSHORT,<);
+	IFVT(ifgtvt_s,ADDRSHORT,>);
+	IFCT(ifeqct_ll,CONLONG,ADDRLONG,==);
+	IFCT(ifnect_ll,CONLONG,ADDRLONG,!=);
+	IFCT(ifltct_ll,CONLONG,ADDRLONG,<);
+	IFCT(ifgtct_ll,CONLONG,ADDRLONG,>);
+	IFCT(ifeqct_ls,CONLONG,ADDRSHORT,==);
+	IFCT(ifnect_ls,CONLONG,ADDRSHORT,!=);
+	IFCT(ifltct_ls,CONLONG,ADDRSHORT,<);
+	IFCT(ifgtct_ls,CONLONG,ADDRSHORT,>);
+	IFCT(ifeqct_sl,CONSMALL,ADDRLONG,==);
+	IFCT(ifnect_sl,CONSMALL,ADDRLONG,!=);
+	IFCT(ifltct_sl,CONSMALL,ADDRLONG,<);
+	IFCT(ifgtct_sl,CONSMALL,ADDRLONG,>);
+	IFCT(ifeqct_ss,CONSMALL,ADDRSHORT,==);
+	IFCT(ifnect_ss,CONSMALL,ADDRSHORT,!=);
+	IFCT(ifltct_ss,CONSMALL,ADDRSHORT,<);
+	IFCT(ifgtct_ss,CONSMALL,ADDRSHORT,>);
+
+	/* list opcodes, as listhandler */
+list1v:
+	i=(op+1)&0x1f;
+	a4=L9Pointers[i]+*pc++;
+	d0=vars[*pc++];
+	if (a4>=L9ListMin[i] && a4<L9ListMax[i])
+	{
+		*a4=(L9BYTE) d0;
+		MARKDIRTY(a4);
+	}
+	NEXT;
+listv1v:
+	i=(op+1)&0x1f;
+	a4=L9Pointers[i]+vars[*pc++];
+	vars[*pc]=(a4>=L9ListMin[i] && a4<L9ListMax[i]) ? *a4 : 0;
+	pc++;
+	NEXT;
+listv1c:
+	i=(op+1)&0x1f;
+	a4=L9Pointers[i]+*pc++;
+	vars[*pc]=(a4>=L9ListMin[i] && a4<L9ListMax[i]) ? *a4 : 0;
+	pc++;
+	NEXT;
+listvv:
+	i=(op+1)&0x1f;
+	a4=L9Pointers[i]+vars[*pc++];
+	d0=vars[*pc++];
+	if (a4>=L9ListMin[i] && a4<L9ListMax[i])
+	{
+		*a4=(L9BYTE) d0;
+		MARKDIRTY(a4);
+	}
+	NEXT;
+listillegal:
+	error("\rillegal list access %d\r",op&0x1f);
+	Running=FALSE;
+	goto done;
+
+	/* everything else may print, read input or load a new file */
+legacy:
+	code=op;
+	codeptr=pc;
+	executeinstruction();
+	pc=codeptr;
+	if (!Running || RunReason!=L9_RUN_BUDGET) goto done;
+	NEXT;
+
+done:
+	codeptr=pc;
+
+#undef NEXT
+#undef ADDRSHORT
+#undef ADDRLONG
+#undef CONSMALL
+#undef CONLONG
+#undef IFVT
+#undef IFCT
+}
+#endif
+
+#ifdef PREDECODE
+/* A-code is decoded into runs of L9Op entries the first time it is reached.
+   A run carries on past conditional branches and stops after any opcode that
+   always transfers control or that is left to executeinstruction. */
+#define IRPOOLSIZE 8192
+#define IRRUNMAX 64
+#define IRMAXOPLEN 8
+
+enum
+{
+	IR_GOTO, IR_STOP, IR_GOSUB, IR_RETURN, IR_VARCON, IR_VARVAR, IR_ADD, IR_SUB, IR_JUMP,
+	IR_IFEQVT, IR_IFNEVT, IR_IFLTVT, IR_IFGTVT, IR_IFEQCT, IR_IFNECT, IR_IFLTCT, IR_IFGTCT,
+	IR_LIST1V, IR_LISTV1V, IR_LISTV1C, IR_LISTVV, IR_LEGACY, IR_LINK,
+#ifdef FUSEDOPS
+	IR_VARCONIFEQ, IR_VARCONIFNE, IR_VARCONIFLT, IR_VARCONIFGT,
+	IR_LISTIFEQ, IR_LISTIFNE, IR_LISTIFLT, IR_LISTIFGT, IR_SWITCH,
+#endif
+	IR_COUNT
+};
+
+#ifdef FUSEDOPS
+/* a chain of ifeqct on one variable, as a table of chain positions */
+#define IRSWITCHMAX 256
+#define IRSWITCHSPAN 64
+typedef struct L9Switch
+{
+	L9UINT16 lo,span,count;
+	L9BYTE pos[IRSWITCHSPAN];
+} L9Switch;
+
+/* FusedCount holds how often each fused form ran, from IR_VARCONIFEQ on */
+char* FusedNames[IR_COUNT-IR_VARCONIFEQ]=
+{
+	"varcon+ifeqct","varcon+ifnect","varcon+ifltct","varcon+ifgtct",
+	"listv1c+ifeqct","listv1c+ifnect","listv1c+ifltct","listv1c+ifgtct",
+	"ifeqct chain"
+};
+#endif
+
+void irflush(void)
+{
+	irused=0;
+	irgen++;
+	if (irmap) memset(irmap,0,irmapsize*sizeof(L9Op*));
+	irlow=irhigh=NULL;
+#ifdef FUSEDOPS
+	irswitches=0;
+#endif
+}
+
+/* called once a game is loaded, to size the map to the new game data */
+void irreset(void)
+{
+	/* without the memory to decode it the code is run as it stands */
+	if (irpool==NULL)
+	{
+		/* with one more entry for opcodes that are not decoded */
+		if ((irpool=malloc((IRPOOLSIZE+1)*sizeof(L9Op)))==NULL) return;
+		irlegacyop=irpool+IRPOOLSIZE;
+	}
+#ifdef FUSEDOPS
+	if (irswitch==NULL)
+	{
+		L9Allocate((L9BYTE**) &irswitch,IRSWITCHMAX*sizeof(L9Switch));
+		L9Allocate((L9BYTE**) &FusedCount,(IR_COUNT-IR_VARCONIFEQ)*sizeof(L9UINT32));
+		memset(FusedCount,0,(IR_COUNT-IR_VARCONIFEQ)*sizeof(L9UINT32));
+	}
+#endif
+	irmapsize=FileSize;
+	free(irmap);
+	irmap=malloc(irmapsize*sizeof(L9Op*));
+	irflush();
+}
+
+#ifdef FUSEDOPS
+/* replaces common opcode sequences in a newly decoded run by fused forms,
+   leaving the entries that follow in place for branches into the middle */
+void irfuse(L9Op* first,L9Op* end,void* const* h)
+{
+	L9Op* o;
+	L9Switch* s;
+	int i,k,lo,hi;
+
+	/* three or more ifeqct on one variable become a table lookup */
+	for (o=first;o<end;o++)
+	{
+		if (o->kind!=IR_IFEQCT) continue;
+		lo=hi=o->c;
+		for (k=1;o+k<end && o[k].kind==IR_IFEQCT && o[k].a==o->a;k++)
+		{
+			if (o[k].c<lo) lo=o[k].c;
+			if (o[k].c>hi) hi=o[k].c;
+		}
+		if (k>=3 && hi-lo<IRSWITCHSPAN && irswitches<IRSWITCHMAX)
+		{
+			s=irswitch+irswitches;
+			o->b=irswitches++;
+			s->lo=lo;
+			s->span=hi-lo+1;
+			s->count=k;
+			memset(s->pos,0xff,sizeof(s->pos));
+			for (i=k-1;i>=0;i--) s->pos[o[i].c-lo]=i;
+			o->kind=IR_SWITCH;
+			o->handler=h[IR_SWITCH];
+			o+=k-1;
+		}
+	}
+
+	/* varcon or listv1c followed by a test against a constant */
+	for (o=first;o+1<end;o++)
+	{
+		if ((o->kind==IR_VARCON || o->kind==IR_LISTV1C) && o[1].kind>=IR_IFEQCT && o[1].kind<=IR_IFGTCT)
+		{
+			o->kind=(o->kind==IR_VARCON ? IR_VARCONIFEQ : IR_LISTIFEQ)+o[1].kind-IR_IFEQCT;
+			o->handler=h[o->kind];
+		}
+	}
+}
+
+void irreport(void)
+{
+	int i;
+	if (FusedCount==NULL) return;
+	error("\rFused opcodes:\r");
+	for (i=0;i<IR_COUNT-IR_VARCONIFEQ;i++)
+		error("%-16s %lu\r",FusedNames[i],(unsigned long) FusedCount[i]);
+}
+#endif
+
+L9Op* irdecode(L9BYTE* p,void* const* h)
+{
+	L9BYTE *end=startdata+irmapsize;
+	L9BYTE c;
+	L9Op *first,*op;
+	int count=0,kind;
+
+	if (irmap==NULL || p<startdata || p+IRMAXOPLEN>end)
+	{
+		/* too near the edge to decode safely, so just interpret it */
+		irlegacyop->handler=h[IR_LEGACY];
+		irlegacyop->pc=p;
+		return irlegacyop;
+	}
+	if (irused+IRRUNMAX+1>IRPOOLSIZE) irflush();
+
+	first=irpool+irused;
+	while (TRUE)
+	{
+		op=irpool+irused++;
+		op->target=NULL;
+		if (count==IRRUNMAX || p+IRMAXOPLEN>end || irmap[p-startdata])
+		{
+			/* carry on in another run */
+			op->handler=h[IR_LINK];
+			op->kind=IR_LINK;
+			op->pc=op->dest=p;
+			if (p+IRMAXOPLEN<=end) op->target=irmap[p-startdata];
+			break;
+		}
+		irmap[p-startdata]=op;
+		op->pc=p;
+		c=*p++;
+		kind=IR_LEGACY;
+		if (c&0x80)
+		{
+			if ((c&0x1f)<=0xa)
+			{
+				kind=IR_LIST1V+((c>>5)&3);
+				op->c=(c+1)&0x1f;
+				op->a=*p++;
+				op->b=*p++;
+			}
+		}
+		else switch (c&0x1f)
+		{
+			case 0:
+			case 1:
+				if (c&0x20)
+				{
+					op->dest=p+(signed char) *p;
+					p++;
+				}
+				else
+				{
+					op->dest=acodeptr+L9WORD(p);
+					p+=2;
+				}
+				if ((c&0x1f)==1) kind=IR_GOSUB;
+				else kind=(op->dest==p-2) ? IR_STOP : IR_GOTO;
+				break;
+			case 2:
+				kind=IR_RETURN;
+				break;
+			case 8:
+				if (c&0x40) op->c=*p++;
+				else
+				{
+					op->c=L9WORD(p);
+					p+=2;
+				}
+				op->a=*p++;
+				kind=IR_VARCON;
+				break;
+			case 9:
+			case 10:
+			case 11:
+				op->a=*p++;
+				op->b=*p++;
+				kind=IR_VARVAR+(c&0x1f)-9;
+				break;
+			case 14:
+				op->c=L9WORD(p);
+				p+=2;
+				op->a=*p++;
+				kind=IR_JUMP;
+				break;
+			case 16:
+			case 17:
+			case 18:
+			case 19:
+			case 24:
+			case 25:
+			case 26:
+			case 27:
+				op->a=*p++;
+				if (c&0x08)
+				{
+					if (c&0x40) op->c=*p++;
+					else
+					{
+						op->c=L9WORD(p);
+						p+=2;
+					}
+					kind=IR_IFEQCT+(c&3);
+				}
+				else
+				{
+					op->b=*p++;
+					kind=IR_IFEQVT+(c&3);
+				}
+				if (c&0x20)
+				{
+					op->dest=p+(signed char) *p;
+					p++;
+				}
+				else
+				{
+					op->dest=acodeptr+L9WORD(p);
+					p+=2;
+				}
+				break;
+		}
+		op->handler=h[kind];
+		op->kind=kind;
+		op->next=kind==IR_LEGACY ? op->pc+1 : p;
+		if (irlow==NULL || op->pc<irlow) irlow=op->pc;
+		if (p>irhigh) irhigh=p;
+		count++;
+		if (kind<=IR_RETURN || kind==IR_JUMP || kind==IR_LEGACY) break;
+	}
+#ifdef FUSEDOPS
+	irfuse(first,irpool+irused,h);
+#endif
+	return first;
+}
+
+L9Op* irlookup(L9BYTE* p,void* const* h)
+{
+	if (irmap && p>=startdata && p<startdata+irmapsize && irmap[p-startdata])
+		return irmap[p-startdata];
+	return irdecode(p,h);
+}
+
+/* finds the decoded target of a branch, remembering it unless decoding
+   it flushed the cache and so op itself */
+L9Op* irresolve(L9Op* op,void* const* h)
+{
+	int gen=irgen;
+	L9Op* t=irlookup(op->dest,h);
+	if (gen==irgen && t!=irlegacyop) op->target=t;
+	return t;
+}
+
+/* runs up to n opcodes from the decoded cache */
+void executepredecoded(L9UINT32 n)
+{
+	static void* const h[IR_COUNT]=
+	{
+		[IR_GOTO]=&&ir_goto,		[IR_STOP]=&&ir_stop,
+		[IR_GOSUB]=&&ir_gosub,		[IR_RETURN]=&&ir_return,
+		[IR_VARCON]=&&ir_varcon,	[IR_VARVAR]=&&ir_varvar,
+		[IR_ADD]=&&ir_add,		[IR_SUB]=&&ir_sub,
+		[IR_JUMP]=&&ir_jump,
+		[IR_IFEQVT]=&&ir_ifeqvt,	[IR_IFNEVT]=&&ir_ifnevt,
+		[IR_IFLTVT]=&&ir_ifltvt,	[IR_IFGTVT]=&&ir_ifgtvt,
+		[IR_IFEQCT]=&&ir_ifeqct,	[IR_IFNECT]=&&ir_ifnect,
+		[IR_IFLTCT]=&&ir_ifltct,	[IR_IFGTCT]=&&ir_ifgtct,
+		[IR_LIST1V]=&&ir_list1v,	[IR_LISTV1V]=&&ir_listv1v,
+		[IR_LISTV1C]=&&ir_listv1c,	[IR_LISTVV]=&&ir_listvv,
+		[IR_LEGACY]=&&ir_legacy,	[IR_LINK]=&&ir_link,
+#ifdef FUSEDOPS
+		[IR_VARCONIFEQ]=&&ir_varconifeq,	[IR_VARCONIFNE]=&&ir_varconifne,
+		[IR_VARCONIFLT]=&&ir_varconiflt,	[IR_VARCONIFGT]=&&ir_varconifgt,
+		[IR_LISTIFEQ]=&&ir_listifeq,	[IR_LISTIFNE]=&&ir_listifne,
+		[IR_LISTIFLT]=&&ir_listiflt,	[IR_LISTIFGT]=&&ir_listifgt,
+		[IR_SWITCH]=&&ir_switch,
+#endif
+	};
+	L9UINT16* vars=workspace.vartable;
+	L9Op *ip,*o;
+	L9BYTE* a4;
+	L9UINT16 d0;
+
+#define DISPATCH	o=ip++; goto *o->handler
+#define NEXT		if (n--==0) goto done; DISPATCH
+#define TARGET		(o->target ? o->target : irresolve(o,h))
+#define LISTWRITE(v)	if (a4>=L9ListMin[o->c] && a4<L9ListMax[o->c]) \
+			{ \
+				*a4=(L9BYTE) (v); \
+				MARKDIRTY(a4); \
+				if (a4>=irlow && a4<irhigh) \
+				{ \
+					irflush(); \
+					ip=irlookup(o->next,h); \
+				} \
+			}
+
+	ip=irlookup(codeptr,h);
+	NEXT;
+
+ir_goto:
+	ip=TARGET;
+	NEXT;
+ir_stop:
+	codeptr=o->next;
+	Running=FALSE; /* Endless loop! */
+	return;
+ir_gosub:
+	if (workspace.stackptr==STACKSIZE)
+	{
+		codeptr=o->next;
+		error("\rStack overflow error\r");
+		Running=FALSE;
+		return;
+	}
+	workspace.stack[workspace.stackptr++]=(L9UINT16) (o->next-acodeptr);
+	ip=TARGET;
+	NEXT;
+ir_return:
+	if (workspace.stackptr==0)
+	{
+		codeptr=o->next;
+		error("\rStack underflow error\r");
+		Running=FALSE;
+		return;
+	}
+	ip=irlookup(acodeptr+workspace.stack[--workspace.stackptr],h);
+	NEXT;
+
+ir_varcon:
+	vars[o->a]=o->c;
+	NEXT;
+ir_varvar:
+	vars[o->b]=vars[o->a];
+	NEXT;
+ir_add:
+	d0=vars[o->a];
+	vars[o->b]+=d0;
+	NEXT;
+ir_sub:
+	d0=vars[o->a];
+	vars[o->b]-=d0;
+	NEXT;
+ir_jump:
+	a4=acodeptr+((o->c+(vars[o->a]<<1))&0xffff);
+	ip=irlookup(acodeptr+L9WORD(a4),h);
+	NEXT;
+
+ir_ifeqvt:	if (vars[o->a]==vars[o->b]) ip=TARGET; NEXT;
+ir_ifnevt:	if (vars[o->a]!=vars[o->b]) ip=TARGET; NEXT;
+ir_ifltvt:	if (vars[o->a]<vars[o->b]) ip=TARGET; NEXT;
+ir_ifgtvt:	if (vars[o->a]>vars[o->b]) ip=TARGET; NEXT;
+ir_ifeqct:	if (vars[o->a]==o->c) ip=TARGET; NEXT;
+ir_ifnect:	if (vars[o->a]!=o->c) ip=TARGET; NEXT;
+ir_ifltct:	if (vars[o->a]<o->c) ip=TARGET; NEXT;
+ir_ifgtct:	if (vars[o->a]>o->c) ip=TARGET; NEXT;
+
+	/* lists can point into the game data, so writes may change the code */
+ir_list1v:
+	a4=L9Pointers[o->c]+o->a;
+	LISTWRITE(vars[o->b]);
+	NEXT;
+ir_listv1v:
+	a4=L9Pointers[o->c]+vars[o->a];
+	vars[o->b]=(a4>=L9ListMin[o->c] && a4<L9ListMax[o->c]) ? *a4 : 0;
+	NEXT;
+ir_listv1c:
+	a4=L9Pointers[o->c]+o->a;
+	vars[o->b]=(a4>=L9ListMin[o->c] && a4<L9ListMax[o->c]) ? *a4 : 0;
+	NEXT;
+ir_listvv:
+	a4=L9Pointers[o->c]+vars[o->a];
+	d0=vars[o->b];
+	LISTWRITE(d0);
+	NEXT;
+
+ir_legacy:
+	code=*o->pc;
+	codeptr=o->pc+1;
+	executeinstruction();
+	/* the input opcodes write the list 9 buffer, which may also hold code */
+	if (list9startptr+0x20>irlow && list9startptr<irhigh) irflush();
+	if (!Running || RunReason!=L9_RUN_BUDGET) return;
+	ip=irlookup(codeptr,h);
+	NEXT;
+
+ir_link:
+	ip=TARGET;
+	DISPATCH;
+
+#ifdef FUSEDOPS
+	/* fused forms run as their first opcode alone if the budget would run
+	   out part way through */
+#define VARCONIF(lbl,cmp) lbl: \
+	if (n==0) goto ir_varcon; \
+	n--; \
+	FusedCount[o->kind-IR_VARCONIFEQ]++; \
+	vars[o->a]=o->c; \
+	o++; \
+	ip++; \
+	if (vars[o->a] cmp o->c) ip=TARGET; \
+	NEXT
+#define LISTIF(lbl,cmp) lbl: \
+	if (n==0) goto ir_listv1c; \
+	n--; \
+	FusedCount[o->kind-IR_VARCONIFEQ]++; \
+	a4=L9Pointers[o->c]+o->a; \
+	vars[o->b]=(a4>=L9ListMin[o->c] && a4<L9ListMax[o->c]) ? *a4 : 0; \
+	o++; \
+	ip++; \
+	if (vars[o->a] cmp o->c) ip=TARGET; \
+	NEXT
+
+	VARCONIF(ir_varconifeq,==);
+	VARCONIF(ir_varconifne,!=);
+	VARCONIF(ir_varconiflt,<);
+	VARCONIF(ir_varconifgt,>);
+	LISTIF(ir_listifeq,==);
+	LISTIF(ir_listifne,!=);
+	LISTIF(ir_listiflt,<);
+	LISTIF(ir_listifgt,>);
+
+ir_switch:
+	{
+		L9Switch* s=irswitch+o->b;
+		L9UINT16 i=vars[o->a]-s->lo;
+		L9UINT16 j=(i<s->span) ? s->pos[i] : 0xff;
+		L9UINT16 ran=(j==0xff) ? s->count : j+1;
+
+		if (ran-1>n) goto ir_ifeqct;
+		n-=ran-1;
+		FusedCount[IR_SWITCH-IR_VARCONIFEQ]++;
+		if (j==0xff) ip=o+s->count;
+		else
+		{
+			o+=j;
+			ip=TARGET;
+		}
+	}
+	NEXT;
+#undef VARCONIF
+#undef LISTIF
 #endif
 
+done:
+	codeptr=ip->pc;
+
+#undef DISPATCH
+#undef NEXT
+#undef TARGET
+#undef LISTWRITE
+}
+#endif
+
+#ifdef AOTCODE
+/* the translated code can only be used with the game data it came from */
+void aotcheck(void)
+{
+	aotlow=startdata+l9aot_low;
+	aothigh=startdata+l9aot_high;
+	aotvalid=FileSize==l9aot_filesize && acodeptr==startdata+l9aot_acode
+		&& memcmp(aotlow,l9aot_code,l9aot_high-l9aot_low)==0;
+
+	/* input writes list 9 directly rather than through the list opcodes */
+	if (list9startptr+0x20>aotlow && list9startptr<aothigh) aotvalid=FALSE;
+}
+#endif
+
+#ifdef L9PRELOAD
+/* loads the part named by the LastGame of the context it is given */
+void* preloadpart(void* arg)
+{
+	l9ctx=(L9Context*) arg;
+	if (!intinitialise(LastGame,NULL)) FreeMemory();
+	return NULL;
+}
+
+/* starts loading the files of the game's other parts, as
+   os_set_filenumber() names them, while they fit in preloadlimit */
+void startpreloads(char* filename)
+{
+	char name[MAX_PATH];
+	L9UINT32 total=0,size,window=scanwindow;
+	L9BOOL rescan=Rescan;
+	L9Context *ctx,*old;
+	FILE* f;
+	int n,i;
+
+	for (n=1;n<=PRELOADPARTS;n++)
+	{
+		strcpy(name,filename);
+		os_set_filenumber(name,MAX_PATH,n);
+		if (strcmp(name,filename)==0) continue;
+		for (i=0;i<preloads && strcmp(preload[i].name,name)!=0;i++);
+		if (i<preloads || (f=fopen(name,"rb"))==NULL) continue;
+		size=filelength(f);
+		fclose(f);
+		if (size>preloadlimit-total || (ctx=NewContext())==NULL) continue;
+
+		old=SetContext(ctx);
+		strcpy(LastGame,name);
+		Rescan=rescan;
+		scanwindow=window;
+		preloading=TRUE;
+		SetContext(old);
+		if (pthread_create(&preload[preloads].thread,NULL,preloadpart,ctx)!=0)
+		{
+			FreeContext(ctx);
+			break;
+		}
+		strcpy(preload[preloads].name,name);
+		preload[preloads++].ctx=ctx;
+		total+=size;
+	}
+}
+
+/* takes over the file of the part loaded from filename in the
+   background, with what scanning it found, if that part is loaded */
+L9BOOL takepreload(char* filename)
+{
+	L9Context *ctx,*old;
+	L9BYTE *file,*pictures,*dirty;
+	L9UINT32 filemap,size,picmap;
+	L9BOOL stream;
+	ScanResult result;
+	int i;
+
+	for (i=0;i<preloads && strcmp(preload[i].name,filename)!=0;i++);
+	if (i==preloads) return FALSE;
+	pthread_join(preload[i].thread,NULL);
+	ctx=preload[i].ctx;
+	preload[i]=preload[--preloads];
+
+	old=SetContext(ctx);
+	file=startfile;
+	filemap=startfilemap;
+	dirty=dirtymap;
+	dirtymap=NULL;
+	size=file ? FileSize+(startdata-startfile) : 0;
+	/* picture data found in a streamed file */
+	pictures=pictureaddress;
+	picmap=picturemap;
+	stream=streamed;
+	result=scanresult;
+	startfile=pictureaddress=NULL;
+	SetContext(old);
+	FreeContext(ctx);
+	if (file==NULL) return FALSE;
+
+	if (startfile) freefile(startfile,startfilemap);
+	startfile=file;
+	startfilemap=filemap;
+	free(dirtymap);
+	dirtymap=dirty;
+	FileSize=size;
+	pictureaddress=pictures;
+	picturemap=picmap;
+	streamed=stream;
+	scanresult=result;
+	return TRUE;
+}
+
+/* waits for the parts still loading, and frees them all */
+void stoppreloads(void)
+{
+	while (preloads>0)
+	{
+		preloads--;
+		pthread_join(preload[preloads].thread,NULL);
+		FreeContext(preload[preloads].ctx);
+	}
+}
+#endif
+
+L9BOOL LoadGame2(char *filename,char *picname)
+{
 	/* may be already running a game, maybe in input routine */
 	Running=FALSE;
 	ibuffptr=NULL;
 
 /* intstart */
 	if (!intinitialise(filename,picname)) return FALSE;
+#ifdef PREDECODE
+	irreset();
+#endif
+#ifdef AOTCODE
+	aotcheck();
+#endif
+	/* input and the driver write list 9 directly rather than through listhandler */
+	if (list9startptr)
+	{
+		MARKDIRTY(list9startptr);
+		MARKDIRTY(list9startptr+0x1f);
+	}
+	if (Profiling) ProfileStart();
 /*	if (!checksumgamedata()) return FALSE; */
 
 	codeptr=acodeptr;
@@ -3940,17 +7304,34 @@ L9BOOL LoadGame2(char *filename,char *picname)
 	else
 		randomseed=(L9UINT16)time(NULL);
 	strcpy(LastGame,filename);
+	InputWait=L9_RUN_BUDGET;
+	InputReady=FALSE;
 	return Running=TRUE;
 }
 
 L9BOOL LoadGame(char *filename,char *picname)
 {
-	L9BOOL ret=LoadGame2(filename,picname);
+	L9BOOL ret;
+
+	if (l9ctx==&l9default) defaultcontext();
+#ifdef L9PRELOAD
+	/* parts of another game are no use */
+	stoppreloads();
+#endif
+	/* the statistics are kept until the game first asks for input */
+	memset(loadstats,0,sizeof(loadstats));
+	booting=LoadStats;
+	ret=LoadGame2(filename,picname);
 	showtitle=1;
 	clearworkspace();
 	workspace.stackptr=0;
 	/* need to clear listarea as well */
 	memset((L9BYTE*) workspace.listarea,0,LISTAREASIZE);
+#ifdef L9PRELOAD
+	if (ret && preloadlimit>0) startpreloads(filename);
+#endif
+	booting=booting && ret;
+	if (booting) bootstart=loadclock();
 	return ret;
 }
 
@@ -3960,14 +7341,105 @@ void StopGame(void)
 	Running=FALSE;
 }
 
+/* runs one opcode, always in the interpreter, as the translated code of
+   AOTCODE only pays for itself over a slice */
 L9BOOL RunGame(void)
 {
+	if (InputWait!=L9_RUN_BUDGET) return Running;
+	if (Tracing || Profiling)
+	{
+		slowinstruction();
+		return Running;
+	}
 	code=*codeptr++;
 /*	printf("%d",code); */
 	executeinstruction();
 	return Running;
 }
 
+/* runs up to max_instructions opcodes, returning early when input is
+   requested, output is flushed or the game stops */
+L9BOOL RunGameSlice(L9UINT32 max_instructions, L9RunReason* reason)
+{
+	/* a parked game stays where it is until input is supplied */
+	if (InputWait!=L9_RUN_BUDGET)
+	{
+		if (reason) *reason=InputWait;
+		return Running;
+	}
+	RunReason=L9_RUN_BUDGET;
+	if (Tracing || Profiling)
+	{
+		/* these always take the slow path, so cost nothing otherwise */
+		while (Running && max_instructions--)
+		{
+			slowinstruction();
+			if (RunReason!=L9_RUN_BUDGET) break;
+		}
+	}
+	else
+	{
+#ifdef AOTCODE
+		/* run native code wherever there is some for the opcode reached,
+		   and interpret the rest */
+		while (Running && max_instructions)
+		{
+			if (aotvalid && aotentry(codeptr))
+			{
+				l9aot_run(&max_instructions);
+				if (!Running || RunReason!=L9_RUN_BUDGET || max_instructions==0) break;
+			}
+			max_instructions--;
+			code=*codeptr++;
+			executeinstruction();
+			if (RunReason!=L9_RUN_BUDGET) break;
+		}
+#elif defined(PREDECODE)
+		if (Running) executepredecoded(max_instructions);
+#elif defined(THREADEDCODE)
+		if (Running) executethreaded(max_instructions);
+#else
+		while (Running && max_instructions--)
+		{
+			code=*codeptr++;
+			executeinstruction();
+			if (RunReason!=L9_RUN_BUDGET) break;
+		}
+#endif
+	}
+	if (!Running) RunReason=L9_RUN_STOPPED;
+	if (reason) *reason=RunReason;
+	return Running;
+}
+
+/* in resumable mode, input opcodes and key waits park the game instead of
+   calling os_input() and os_readchar(), see L9SupplyInput() */
+void SetResumableInput(L9BOOL on)
+{
+	ResumableInput=on;
+	InputWait=L9_RUN_BUDGET;
+	InputReady=FALSE;
+}
+
+/* gives a parked game the line it wants, without a newline, or the key it
+   wants as the first character, where "" means no key was pressed */
+L9BOOL L9SupplyInput(const char* text)
+{
+	if (InputWait==L9_NEED_INPUT)
+	{
+		/* leaving room for the space inputV2() adds */
+		strncpy(ibuff,text,IBUFFSIZE-2);
+		ibuff[IBUFFSIZE-2]=0;
+	}
+	else if (InputWait==L9_NEED_KEY)
+		InputKey=*text;
+	else
+		return FALSE;
+	InputWait=L9_RUN_BUDGET;
+	InputReady=TRUE;
+	return TRUE;
+}
+
 void RestoreGame(char* filename)
 {
 	int Bytes;
@@ -3989,7 +7461,7 @@ void RestoreGame(char* filename)
 			printstring("\rGame restored.\r");
 			/* full restore */
 			memmove(&workspace,&temp,sizeof(GameState));
-			codeptr=acodeptr+workspace.codeptr;
+			codeptr=acodeptr+*savedcode(&workspace);
 		}
 		else
 			printstring("\rSorry, unrecognised format. Unable to restore\r");
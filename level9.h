@@ -84,6 +84,39 @@ typedef struct
 	L9UINT16 npalette;
 } Bitmap;
 
+typedef enum
+{
+	L9_RUN_BUDGET,		/* instruction budget used up */
+	L9_RUN_INPUT,		/* an input opcode was run */
+	L9_RUN_FLUSH,		/* output was flushed, e.g. waiting for a key */
+	L9_RUN_STOPPED,		/* game stopped */
+	L9_NEED_INPUT,		/* parked until L9SupplyInput() gives a line */
+	L9_NEED_KEY			/* parked until L9SupplyInput() gives a key */
+} L9RunReason;
+
+/* the phases of loading a game that GetLoadStats() reports on */
+typedef enum
+{
+	L9_LOAD_FILE,			/* reading the game file */
+	L9_LOAD_PICTURES,		/* reading the picture file */
+	L9_LOAD_SCAN,			/* looking for a V3 or V4 game */
+	L9_LOAD_SCANV2,			/* then a V2 game */
+	L9_LOAD_SCANV1,			/* then a V1 game */
+	L9_LOAD_MESSAGES,		/* working out the message format */
+	L9_LOAD_PICTUREDATA,	/* finding the graphics subroutines */
+	L9_LOAD_BOOT,			/* running the game until it asks for input */
+	L9_LOAD_PHASES
+} L9LoadPhase;
+
+typedef struct
+{
+	double seconds;
+	L9UINT32 bytes;		/* most memory allocated at once */
+} L9LoadStat;
+
+/* the state of one game, see l9context.h */
+typedef struct L9Context L9Context;
+
 #define MAX_BITMAP_WIDTH 512
 #define MAX_BITMAP_HEIGHT 218
 
@@ -130,11 +163,34 @@ L9BOOL os_find_file(char* NewName);
 /* routines provided by level9 interpreter */
 L9BOOL LoadGame(char* filename, char* picname);
 L9BOOL RunGame(void);
+L9BOOL RunGameSlice(L9UINT32 max_instructions, L9RunReason* reason);
 void StopGame(void);
 void RestoreGame(char* filename);
 void FreeMemory(void);
 void GetPictureSize(int* width, int* height);
 L9BOOL RunGraphics(void);
+L9BOOL TraceStart(char* filename);
+void TraceStop(void);
+L9BOOL ProfileStart(void);
+void ProfileStop(void);
+void ProfileReport(void);
+L9BOOL ProfileWrite(char* filename);
+void SetLoadStats(L9BOOL on);
+const L9LoadStat* GetLoadStats(void);
+void LoadStatsReport(void);
+L9BOOL LoadStatsWrite(char* filename);
+L9Context* NewContext(void);
+void FreeContext(L9Context* ctx);
+L9Context* SetContext(L9Context* ctx);
+L9Context* CloneContext(L9Context* ctx);
+void SetResumableInput(L9BOOL on);
+L9BOOL L9SupplyInput(const char* text);
+void SetRescan(L9BOOL on);
+void SetScanCache(L9BOOL on);
+void SetScanWindow(L9UINT32 size);
+void SetPreloadLimit(L9UINT32 size);
+const char* GetGameName(void);
+L9UINT32 GetScanMemory(void);
 
 /* bitmap routines provided by level9 interpreter */
 BitmapType DetectBitmaps(char* dir);